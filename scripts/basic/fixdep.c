@@ -77,6 +77,18 @@
  * dependencies on include/config/MY_OPTION for every
  * CONFIG_MY_OPTION encountered in any of the prerequisites.
  *
+ * It can also be invoked as
+ *
+ *   fixdep --batch
+ *
+ * to handle many depfiles in one process. It then reads records of four
+ * NUL-terminated fields from stdin:
+ *
+ *   <depfile> <target> <cmdline> <output>
+ *
+ * and writes the dependency snippet for each record to <output>. The records
+ * are distributed over one worker per online CPU.
+ *
  * We don't even try to really parse the header files, but
  * merely grep, i.e. if CONFIG_FOO is mentioned in a comment, it will
  * be picked up as well. It's not a problem with respect to
@@ -91,22 +103,101 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <unistd.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <string.h>
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <ctype.h>
 
 #include <xalloc.h>
 
 static void usage(void)
 {
 	fprintf(stderr, "Usage: fixdep <depfile> <target> <cmdline>\n");
+	fprintf(stderr, "       fixdep --batch\n");
 	exit(1);
 }
 
+/*
+ * The output for a target is collected here and written out in one go once
+ * the target is done.
+ */
+static struct {
+	char	*p;
+	size_t	len;
+	size_t	size;
+} out;
+
+static void out_add(const char *s, size_t len)
+{
+	if (out.len + len > out.size) {
+		out.size = out.size ? out.size * 2 : 4096;
+		if (out.size < out.len + len)
+			out.size = out.len + len;
+		out.p = xrealloc(out.p, out.size);
+	}
+	memcpy(out.p + out.len, s, len);
+	out.len += len;
+}
+
+static void out_puts(const char *s)
+{
+	out_add(s, strlen(s));
+}
+
+static void __attribute__((format(printf, 1, 2))) out_printf(const char *fmt, ...)
+{
+	va_list ap;
+	int len;
+
+	va_start(ap, fmt);
+	len = vsnprintf(NULL, 0, fmt, ap);
+	va_end(ap);
+
+	/* make room for the terminating NUL written by vsnprintf() */
+	if (out.len + len + 1 > out.size) {
+		out.size = out.size * 2 > out.len + len + 1 ?
+			   out.size * 2 : out.len + len + 1;
+		out.p = xrealloc(out.p, out.size);
+	}
+	va_start(ap, fmt);
+	vsnprintf(out.p + out.len, len + 1, fmt, ap);
+	va_end(ap);
+	out.len += len;
+}
+
+static void out_write(int fd)
+{
+	const char *p = out.p;
+	size_t len = out.len;
+
+	while (len) {
+		ssize_t n = write(fd, p, len);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		p += n;
+		len -= n;
+	}
+
+	/*
+	 * In the intended usage, the output is redirected to .*.cmd files.
+	 * Catch errors such as "No space left on device".
+	 */
+	if (len) {
+		fprintf(stderr, "fixdep: not all data was written to the output\n");
+		exit(1);
+	}
+	out.len = 0;
+}
+
 struct item {
 	struct item	*next;
 	unsigned int	len;
@@ -163,6 +254,21 @@ static bool in_hashtable(const char *name, int len, struct item *hashtab[])
 	return false;
 }
 
+/* Forget the strings seen so far, before starting on the next target. */
+static void clear_hashtable(struct item *hashtab[])
+{
+	struct item *aux, *next;
+	int i;
+
+	for (i = 0; i < HASHSZ; i++) {
+		for (aux = hashtab[i]; aux; aux = next) {
+			next = aux->next;
+			free(aux);
+		}
+		hashtab[i] = NULL;
+	}
+}
+
 /*
  * Record the use of a CONFIG_* word.
  */
@@ -172,7 +278,9 @@ static void use_config(const char *m, int slen)
 		return;
 
 	/* Print out a dependency path from a symbol name. */
-	printf("    $(wildcard include/config/%.*s) \\\n", slen, m);
+	out_puts("    $(wildcard include/config/");
+	out_add(m, slen);
+	out_puts(") \\\n");
 }
 
 /* test if s ends in sub */
@@ -186,19 +294,31 @@ static int str_ends_with(const char *s, int slen, const char *sub)
 	return !memcmp(s + slen - sublen, sub, sublen);
 }
 
+/* characters that may appear in a CONFIG_* word */
+static const unsigned char is_word_char[256] = {
+	['0' ... '9'] = 1,
+	['A' ... 'Z'] = 1,
+	['a' ... 'z'] = 1,
+	['_'] = 1,
+};
+
+/*
+ * The search for "CONFIG_" is left to strstr(), which the C library already
+ * vectorizes for the CPU it runs on.
+ */
 static void parse_config_file(const char *p)
 {
 	const char *q, *r;
 	const char *start = p;
 
 	while ((p = strstr(p, "CONFIG_"))) {
-		if (p > start && (isalnum(p[-1]) || p[-1] == '_')) {
+		if (p > start && is_word_char[(unsigned char)p[-1]]) {
 			p += 7;
 			continue;
 		}
 		p += 7;
 		q = p;
-		while (isalnum(*q) || *q == '_')
+		while (is_word_char[(unsigned char)*q])
 			q++;
 		if (str_ends_with(p, q - p, "_MODULE"))
 			r = q - 7;
@@ -210,11 +330,9 @@ static void parse_config_file(const char *p)
 	}
 }
 
-static void *read_file(const char *filename)
+static int open_file(const char *filename, struct stat *st)
 {
-	struct stat st;
 	int fd;
-	char *buf;
 
 	fd = open(filename, O_RDONLY);
 	if (fd < 0) {
@@ -222,11 +340,22 @@ static void *read_file(const char *filename)
 		perror(filename);
 		exit(2);
 	}
-	if (fstat(fd, &st) < 0) {
+	if (fstat(fd, st) < 0) {
 		fprintf(stderr, "fixdep: error fstat'ing file: ");
 		perror(filename);
 		exit(2);
 	}
+
+	return fd;
+}
+
+static void *read_file(const char *filename)
+{
+	struct stat st;
+	int fd;
+	char *buf;
+
+	fd = open_file(filename, &st);
 	buf = xmalloc(st.st_size + 1);
 	if (read(fd, buf, st.st_size) != st.st_size) {
 		perror("fixdep: read");
@@ -238,6 +367,32 @@ static void *read_file(const char *filename)
 	return buf;
 }
 
+/*
+ * Prerequisites are only scanned, so they are all read into the same buffer
+ * rather than allocating one for each.
+ */
+static void scan_file(const char *filename)
+{
+	static char *buf;
+	static size_t size;
+	struct stat st;
+	int fd;
+
+	fd = open_file(filename, &st);
+	if (st.st_size + 1 > size) {
+		size = st.st_size + 1;
+		buf = xrealloc(buf, size);
+	}
+	if (read(fd, buf, st.st_size) != st.st_size) {
+		perror("fixdep: read");
+		exit(2);
+	}
+	buf[st.st_size] = '\0';
+	close(fd);
+
+	parse_config_file(buf);
+}
+
 /* Ignore certain dependencies */
 static int is_ignored_file(const char *s, int len)
 {
@@ -375,23 +530,18 @@ static void parse_dep_file(char *p, const char *target)
 			 */
 			if (!saw_any_target) {
 				saw_any_target = true;
-				printf("source_%s := %s\n\n", target, p);
-				printf("deps_%s := \\\n", target);
+				out_printf("source_%s := %s\n\n", target, p);
+				out_printf("deps_%s := \\\n", target);
 				need_parse = true;
 			}
 		} else if (!is_ignored_file(p, q - p) &&
 			   !in_hashtable(p, q - p, file_hashtab)) {
-			printf("  %s \\\n", p);
+			out_printf("  %s \\\n", p);
 			need_parse = true;
 		}
 
-		if (need_parse && !is_no_parse_file(p, q - p)) {
-			void *buf;
-
-			buf = read_file(p);
-			parse_config_file(buf);
-			free(buf);
-		}
+		if (need_parse && !is_no_parse_file(p, q - p))
+			scan_file(p);
 
 		is_source = false;
 		*q = saved_c;
@@ -403,38 +553,172 @@ static void parse_dep_file(char *p, const char *target)
 		exit(1);
 	}
 
-	printf("\n%s: $(deps_%s)\n\n", target, target);
-	printf("$(deps_%s):\n", target);
+	out_printf("\n%s: $(deps_%s)\n\n", target, target);
+	out_printf("$(deps_%s):\n", target);
 }
 
-int main(int argc, char *argv[])
+static void fixdep(const char *depfile, const char *target,
+		   const char *cmdline, int fd)
 {
-	const char *depfile, *target, *cmdline;
 	void *buf;
 
-	if (argc != 4)
-		usage();
-
-	depfile = argv[1];
-	target = argv[2];
-	cmdline = argv[3];
-
-	printf("savedcmd_%s := %s\n\n", target, cmdline);
+	out_printf("savedcmd_%s := %s\n\n", target, cmdline);
 
 	buf = read_file(depfile);
 	parse_dep_file(buf, target);
 	free(buf);
 
-	fflush(stdout);
+	out_write(fd);
 
-	/*
-	 * In the intended usage, the stdout is redirected to .*.cmd files.
-	 * Call ferror() to catch errors such as "No space left on device".
-	 */
-	if (ferror(stdout)) {
+	clear_hashtable(config_hashtab);
+	clear_hashtable(file_hashtab);
+}
+
+struct job {
+	const char	*depfile;
+	const char	*target;
+	const char	*cmdline;
+	const char	*output;
+};
+
+static void run_job(const struct job *job)
+{
+	int fd;
+
+	fd = open(job->output, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0) {
+		fprintf(stderr, "fixdep: error opening file: ");
+		perror(job->output);
+		exit(2);
+	}
+	fixdep(job->depfile, job->target, job->cmdline, fd);
+	if (close(fd)) {
 		fprintf(stderr, "fixdep: not all data was written to the output\n");
 		exit(1);
 	}
+}
+
+/*
+ * Read the records from stdin. The fields point into *bufp, which must be
+ * freed after the jobs.
+ */
+static struct job *read_jobs(int *nr_jobs, char **bufp)
+{
+	struct job *jobs = NULL;
+	char *buf = NULL, *p, *end;
+	size_t len = 0, size = 0;
+	const char **field;
+	int nr = 0, alloc = 0;
+	ssize_t n;
+
+	for (;;) {
+		if (len == size) {
+			size = size ? size * 2 : 65536;
+			buf = xrealloc(buf, size);
+		}
+		n = read(STDIN_FILENO, buf + len, size - len);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("fixdep: read");
+			exit(2);
+		}
+		if (n == 0)
+			break;
+		len += n;
+	}
+
+	for (p = buf, end = buf + len; p < end; nr++) {
+		if (nr == alloc) {
+			alloc = alloc ? alloc * 2 : 64;
+			jobs = xrealloc(jobs, alloc * sizeof(*jobs));
+		}
+		for (field = &jobs[nr].depfile; field <= &jobs[nr].output; field++) {
+			char *nul = memchr(p, '\0', end - p);
+
+			if (!nul) {
+				fprintf(stderr, "fixdep: truncated record in batch input\n");
+				exit(1);
+			}
+			*field = p;
+			p = nul + 1;
+		}
+	}
+
+	*nr_jobs = nr;
+	*bufp = buf;
+	return jobs;
+}
+
+/*
+ * Process the records read from stdin. Each worker takes every nth record and
+ * reuses its hashtables and output buffer from one target to the next.
+ */
+static int batch(void)
+{
+	struct job *jobs;
+	char *buf;
+	int nr_jobs, nr_workers, i, ret = 0;
+	long cpus;
+
+	jobs = read_jobs(&nr_jobs, &buf);
+
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	nr_workers = cpus > 1 ? cpus : 1;
+	if (nr_workers > nr_jobs)
+		nr_workers = nr_jobs;
+
+	if (nr_workers <= 1) {
+		for (i = 0; i < nr_jobs; i++)
+			run_job(&jobs[i]);
+		goto out;
+	}
+
+	for (i = 0; i < nr_workers; i++) {
+		pid_t pid = fork();
+
+		if (pid < 0) {
+			perror("fixdep: fork");
+			ret = 1;
+			break;
+		}
+		if (pid == 0) {
+			int j;
+
+			for (j = i; j < nr_jobs; j += nr_workers)
+				run_job(&jobs[j]);
+			_exit(0);
+		}
+	}
+
+	for (;;) {
+		int status;
+
+		if (wait(&status) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		if (!WIFEXITED(status) || WEXITSTATUS(status))
+			ret = 1;
+	}
+
+out:
+	free(jobs);
+	free(buf);
+
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc == 2 && !strcmp(argv[1], "--batch"))
+		return batch();
+
+	if (argc != 4)
+		usage();
+
+	fixdep(argv[1], argv[2], argv[3], STDOUT_FILENO);
 
 	return 0;
 }
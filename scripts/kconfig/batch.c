@@ -0,0 +1,718 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Batch evaluation of SYM_BATCH_LANES configurations at once.
+ *
+ * Every lane holds one configuration, given by its user values. The values of
+ * bool and tristate symbols are kept as two bit-planes (see struct
+ * tristate_lanes), so that an expression is evaluated for all lanes with a few
+ * word-wide operations. The values of int, hex and string symbols and the
+ * members of choices are resolved lane by lane.
+ *
+ * The rules are the ones of sym_calc_value(). The values of the symbols
+ * themselves are not touched.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <xalloc.h>
+#include "internal.h"
+#include "lkc.h"
+
+enum {
+	BATCH_TODO,
+	BATCH_BUSY,
+	BATCH_DONE,
+};
+
+struct sym_batch {
+	/* number of symbols when the batch was created */
+	unsigned int nr_syms;
+	unsigned char *state;
+	bool *choice_done;
+
+	/* user values, per symbol id */
+	uint64_t *has_user;
+	struct tristate_lanes *user;
+	const char **user_str;
+	/* when the user values were set, the latest choice member wins */
+	unsigned int *user_seq;
+	unsigned int seq;
+
+	/* calculated values, per symbol id */
+	struct tristate_lanes *val;
+	struct tristate_lanes *visible;
+	uint64_t *unmet;
+	const char **str;
+
+	/* lanes in which modules are enabled */
+	uint64_t modules;
+};
+
+static void batch_calc_sym(struct sym_batch *b, struct symbol *sym);
+
+static bool batch_has_sym(struct sym_batch *b, struct symbol *sym)
+{
+	return !(sym->flags & SYMBOL_CONST) && sym->id < b->nr_syms;
+}
+
+static inline bool lane_test(uint64_t mask, unsigned int lane)
+{
+	return mask >> lane & 1;
+}
+
+/* lanes in which sym behaves like a boolean, see sym_get_type() */
+static uint64_t batch_bool_lanes(struct sym_batch *b, struct symbol *sym)
+{
+	return sym->type == S_TRISTATE ? ~b->modules : ~0ULL;
+}
+
+static void lanes_mod_to_yes(struct tristate_lanes *l, uint64_t mask)
+{
+	l->y |= l->m & mask;
+}
+
+/*
+ * the value of sym->curr.val in a lane, which is what defaults and ranges
+ * are taken from
+ */
+static const char *batch_curr_val(struct sym_batch *b, struct symbol *sym,
+				  unsigned int lane)
+{
+	if (!batch_has_sym(b, sym)) {
+		sym_calc_value(sym);
+		return sym->curr.val;
+	}
+
+	batch_calc_sym(b, sym);
+
+	switch (sym->type) {
+	case S_INT:
+	case S_HEX:
+	case S_STRING:
+		return b->str[sym->id * SYM_BATCH_LANES + lane];
+	case S_BOOLEAN:
+	case S_TRISTATE:
+		return "n";
+	default:
+		return sym->name;
+	}
+}
+
+static void batch_calc_visibility(struct sym_batch *b, struct symbol *sym)
+{
+	struct property *prop;
+	struct tristate_lanes vis = lanes_const(no), l;
+
+	for_all_prompts(sym, prop) {
+		expr_calc_lanes(prop->visible.expr, b, &l);
+		vis = lanes_or(vis, l);
+	}
+	lanes_mod_to_yes(&vis, batch_bool_lanes(b, sym));
+
+	b->visible[sym->id] = vis;
+}
+
+/*
+ * calculate the members of a choice lane by lane, see sym_calc_choice()
+ */
+static void batch_calc_choice(struct sym_batch *b, struct menu *choice)
+{
+	struct symbol *sym, *res;
+	struct property *prop;
+	struct menu *menu;
+	struct tristate_lanes l;
+	uint64_t *def_lanes;
+	int nr_defs = 0, i;
+
+	if (b->choice_done[choice->sym->id])
+		return;
+	b->choice_done[choice->sym->id] = true;
+
+	menu_for_each_sub_entry(menu, choice)
+		if (menu->sym && batch_has_sym(b, menu->sym))
+			batch_calc_visibility(b, menu->sym);
+
+	for_all_defaults(choice->sym, prop)
+		nr_defs++;
+	def_lanes = xmalloc((nr_defs + 1) * sizeof(*def_lanes));
+	i = 0;
+	for_all_defaults(choice->sym, prop) {
+		expr_calc_lanes(prop->visible.expr, b, &l);
+		def_lanes[i++] = l.m;
+		sym = prop_get_symbol(prop);
+		if (batch_has_sym(b, sym) && !sym_is_choice_value(sym))
+			batch_calc_visibility(b, sym);
+	}
+
+	menu_for_each_sub_entry(menu, choice)
+		if (menu->sym && batch_has_sym(b, menu->sym))
+			b->val[menu->sym->id] = lanes_const(no);
+
+	for (unsigned int lane = 0; lane < SYM_BATCH_LANES; lane++) {
+#define VISIBLE(s)	lane_test(b->visible[(s)->id].m, lane)
+#define HAS_USER(s)	lane_test(b->has_user[(s)->id], lane)
+#define USER(s)		lanes_get(b->user[(s)->id], lane)
+#define SEQ(s)		b->user_seq[(s)->id * SYM_BATCH_LANES + lane]
+		res = NULL;
+
+		/*
+		 * the visible member with the user value 'y' that was set last,
+		 * see the priority order of choice_members
+		 */
+		list_for_each_entry(sym, &choice->choice_members, choice_link) {
+			if (VISIBLE(sym) && HAS_USER(sym) && USER(sym) == yes &&
+			    (!res || SEQ(sym) > SEQ(res)))
+				res = sym;
+		}
+
+		/* the default, unless it is explicitly set to 'n' */
+		if (!res) {
+			i = 0;
+			for_all_defaults(choice->sym, prop) {
+				if (!lane_test(def_lanes[i++], lane))
+					continue;
+				sym = prop_get_symbol(prop);
+				if (batch_has_sym(b, sym) && VISIBLE(sym)) {
+					res = sym;
+					break;
+				}
+			}
+			if (!res) {
+				menu_for_each_sub_entry(menu, choice) {
+					if (menu->sym &&
+					    batch_has_sym(b, menu->sym) &&
+					    VISIBLE(menu->sym)) {
+						res = menu->sym;
+						break;
+					}
+				}
+			}
+			if (res && HAS_USER(res) && USER(res) == no)
+				res = NULL;
+		}
+
+		/* the first visible, user-unspecified member */
+		if (!res) {
+			menu_for_each_sub_entry(menu, choice) {
+				sym = menu->sym;
+				if (sym && batch_has_sym(b, sym) &&
+				    VISIBLE(sym) && !HAS_USER(sym)) {
+					res = sym;
+					break;
+				}
+			}
+		}
+
+		/* the least prioritized visible member */
+		if (!res) {
+			list_for_each_entry(sym, &choice->choice_members,
+					    choice_link) {
+				if (VISIBLE(sym) && (!res || SEQ(sym) < SEQ(res)))
+					res = sym;
+			}
+		}
+
+		if (res && batch_has_sym(b, res)) {
+			b->val[res->id].m |= 1ULL << lane;
+			b->val[res->id].y |= 1ULL << lane;
+		}
+#undef VISIBLE
+#undef HAS_USER
+#undef USER
+#undef SEQ
+	}
+
+	/* the members are calculated together */
+	menu_for_each_sub_entry(menu, choice)
+		if (menu->sym && batch_has_sym(b, menu->sym) &&
+		    b->state[menu->sym->id] == BATCH_TODO)
+			b->state[menu->sym->id] = BATCH_DONE;
+
+	free(def_lanes);
+}
+
+static void batch_calc_tristate(struct sym_batch *b, struct symbol *sym)
+{
+	unsigned int id = sym->id;
+	uint64_t bool_lanes = batch_bool_lanes(b, sym);
+	struct tristate_lanes newval, dir, rev, imp, def, vis, l;
+	struct property *prop;
+	struct menu *choice_menu;
+	uint64_t user, left;
+
+	batch_calc_visibility(b, sym);
+
+	choice_menu = sym_get_choice_menu(sym);
+	if (choice_menu) {
+		batch_calc_choice(b, choice_menu);
+		newval = b->val[id];
+		goto out;
+	}
+
+	expr_calc_lanes(sym->dir_dep.expr, b, &dir);
+	lanes_mod_to_yes(&dir, bool_lanes);
+	rev = lanes_const(no);
+	if (sym->rev_dep.expr)
+		expr_calc_lanes(sym->rev_dep.expr, b, &rev);
+	lanes_mod_to_yes(&rev, bool_lanes);
+	imp = lanes_const(no);
+	if (sym->implied.expr)
+		expr_calc_lanes(sym->implied.expr, b, &imp);
+	lanes_mod_to_yes(&imp, bool_lanes);
+
+	/* lanes in which the symbol is visible and has a user value */
+	user = b->visible[id].m & b->has_user[id];
+
+	/* the first visible default, in the other lanes */
+	def = lanes_const(no);
+	left = ~user;
+	if (!sym_is_choice(sym)) {
+		for_all_defaults(sym, prop) {
+			uint64_t sel;
+
+			if (!left)
+				break;
+			expr_calc_lanes(prop->visible.expr, b, &vis);
+			sel = left & vis.m;
+			if (!sel)
+				continue;
+			expr_calc_lanes(prop->expr, b, &l);
+			def = lanes_select(sel, lanes_and(l, vis), def);
+			left &= ~sel;
+		}
+		l = lanes_and(lanes_or(def, imp), dir);
+		def = lanes_select(imp.m, l, def);
+	}
+
+	newval = lanes_select(user, lanes_and(b->user[id], b->visible[id]),
+			      def);
+	b->unmet[id] = lanes_less(dir, rev);
+	newval = lanes_or(newval, rev);
+out:
+	lanes_mod_to_yes(&newval, bool_lanes);
+	b->val[id] = newval;
+}
+
+static long long batch_range_val(struct sym_batch *b, struct symbol *sym,
+				 unsigned int lane, int base)
+{
+	switch (sym->type) {
+	case S_INT:
+		base = 10;
+		break;
+	case S_HEX:
+		base = 16;
+		break;
+	default:
+		break;
+	}
+	return strtoll(batch_curr_val(b, sym, lane), NULL, base);
+}
+
+/* see sym_validate_range() */
+static void batch_validate_range(struct sym_batch *b, struct symbol *sym)
+{
+	const char **str = &b->str[sym->id * SYM_BATCH_LANES];
+	struct property *prop;
+	struct tristate_lanes vis;
+	uint64_t left = ~0ULL, sel;
+	int base = sym->type == S_HEX ? 16 : 10;
+
+	for_all_properties(sym, prop, P_RANGE) {
+		if (!left)
+			break;
+		expr_calc_lanes(prop->visible.expr, b, &vis);
+		sel = left & vis.m;
+		left &= ~sel;
+
+		for (unsigned int lane = 0; lane < SYM_BATCH_LANES; lane++) {
+			struct symbol *range_sym = prop->expr->left.sym;
+			long long val;
+
+			if (!lane_test(sel, lane))
+				continue;
+
+			val = strtoll(str[lane], NULL, base);
+			if (val >= batch_range_val(b, range_sym, lane, base)) {
+				range_sym = prop->expr->right.sym;
+				if (val <= batch_range_val(b, range_sym, lane,
+							   base))
+					continue;
+			}
+			str[lane] = batch_curr_val(b, range_sym, lane);
+		}
+	}
+}
+
+static void batch_calc_string(struct sym_batch *b, struct symbol *sym)
+{
+	const char **str = &b->str[sym->id * SYM_BATCH_LANES];
+	const char **user_str = &b->user_str[sym->id * SYM_BATCH_LANES];
+	struct property *prop;
+	struct symbol *ds;
+	struct tristate_lanes vis;
+	uint64_t left, sel;
+
+	batch_calc_visibility(b, sym);
+
+	left = ~(b->visible[sym->id].m & b->has_user[sym->id]);
+	for (unsigned int lane = 0; lane < SYM_BATCH_LANES; lane++)
+		if (!lane_test(left, lane))
+			str[lane] = user_str[lane];
+
+	for_all_defaults(sym, prop) {
+		if (!left)
+			break;
+		expr_calc_lanes(prop->visible.expr, b, &vis);
+		sel = left & vis.m;
+		if (!sel)
+			continue;
+		left &= ~sel;
+
+		ds = prop_get_symbol(prop);
+		if (!ds)
+			continue;
+		for (unsigned int lane = 0; lane < SYM_BATCH_LANES; lane++)
+			if (lane_test(sel, lane))
+				str[lane] = batch_curr_val(b, ds, lane);
+	}
+
+	if (sym->type == S_INT || sym->type == S_HEX)
+		batch_validate_range(b, sym);
+}
+
+static void batch_calc_sym(struct sym_batch *b, struct symbol *sym)
+{
+	unsigned int id = sym->id;
+	const char *def;
+
+	/* a symbol that is calculated recursively has its default value */
+	if (b->state[id] != BATCH_TODO)
+		return;
+	b->state[id] = BATCH_BUSY;
+
+	switch (sym->type) {
+	case S_INT:
+		def = "0";
+		break;
+	case S_HEX:
+		def = "0x0";
+		break;
+	case S_STRING:
+		def = "";
+		break;
+	default:
+		def = NULL;
+		break;
+	}
+	b->val[id] = lanes_const(no);
+	for (unsigned int lane = 0; lane < SYM_BATCH_LANES; lane++)
+		b->str[id * SYM_BATCH_LANES + lane] = def;
+
+	switch (sym->type) {
+	case S_BOOLEAN:
+	case S_TRISTATE:
+		batch_calc_tristate(b, sym);
+		break;
+	case S_INT:
+	case S_HEX:
+	case S_STRING:
+		batch_calc_string(b, sym);
+		break;
+	default:
+		break;
+	}
+
+	b->state[id] = BATCH_DONE;
+}
+
+void sym_batch_lanes(struct sym_batch *b, struct symbol *sym,
+		     struct tristate_lanes *res)
+{
+	if (!batch_has_sym(b, sym)) {
+		sym_calc_value(sym);
+		*res = lanes_const(sym->curr.tri);
+		return;
+	}
+
+	batch_calc_sym(b, sym);
+	*res = b->val[sym->id];
+}
+
+/*
+ * the value of sym in a lane, as sym_get_string_value() would return it
+ */
+const char *sym_batch_string(struct sym_batch *b, struct symbol *sym,
+			     unsigned int lane)
+{
+	struct tristate_lanes l;
+
+	switch (sym->type) {
+	case S_BOOLEAN:
+	case S_TRISTATE:
+		sym_batch_lanes(b, sym, &l);
+		switch (lanes_get(l, lane)) {
+		case no:
+			return "n";
+		case mod:
+			return "m";
+		case yes:
+			return "y";
+		}
+		break;
+	default:
+		break;
+	}
+	return batch_curr_val(b, sym, lane);
+}
+
+/**
+ * sym_batch_new - create a batch of SYM_BATCH_LANES configurations
+ *
+ * Every lane starts with the current user values of the symbols.
+ */
+struct sym_batch *sym_batch_new(void)
+{
+	struct sym_batch *b = xcalloc(1, sizeof(*b));
+	unsigned int nr = sym_array_nr;
+	struct symbol *sym;
+
+	b->nr_syms = nr;
+	b->state = xcalloc(nr, sizeof(*b->state));
+	b->choice_done = xcalloc(nr, sizeof(*b->choice_done));
+	b->has_user = xcalloc(nr, sizeof(*b->has_user));
+	b->user = xcalloc(nr, sizeof(*b->user));
+	b->user_str = xcalloc(nr * SYM_BATCH_LANES, sizeof(*b->user_str));
+	b->user_seq = xcalloc(nr * SYM_BATCH_LANES, sizeof(*b->user_seq));
+	b->val = xcalloc(nr, sizeof(*b->val));
+	b->visible = xcalloc(nr, sizeof(*b->visible));
+	b->unmet = xcalloc(nr, sizeof(*b->unmet));
+	b->str = xcalloc(nr * SYM_BATCH_LANES, sizeof(*b->str));
+
+	for_all_symbols(sym) {
+		if (!sym_has_value(sym))
+			continue;
+
+		b->has_user[sym->id] = ~0ULL;
+		b->user[sym->id] = lanes_const(sym->def[S_DEF_USER].tri);
+		for (unsigned int lane = 0; lane < SYM_BATCH_LANES; lane++)
+			b->user_str[sym->id * SYM_BATCH_LANES + lane] =
+				sym->def[S_DEF_USER].val;
+	}
+
+	/* the head of choice_members has the highest priority */
+	for_all_symbols(sym) {
+		struct menu *choice;
+		struct symbol *member;
+
+		if (!sym_is_choice(sym) || list_empty(&sym->menus))
+			continue;
+
+		choice = list_first_entry(&sym->menus, struct menu, link);
+		list_for_each_entry_reverse(member, &choice->choice_members,
+					    choice_link) {
+			if (!batch_has_sym(b, member))
+				continue;
+			b->seq++;
+			for (unsigned int lane = 0; lane < SYM_BATCH_LANES; lane++)
+				b->user_seq[member->id * SYM_BATCH_LANES + lane] =
+					b->seq;
+		}
+	}
+
+	return b;
+}
+
+void sym_batch_free(struct sym_batch *b)
+{
+	free(b->state);
+	free(b->choice_done);
+	free(b->has_user);
+	free(b->user);
+	free(b->user_str);
+	free(b->user_seq);
+	free(b->val);
+	free(b->visible);
+	free(b->unmet);
+	free(b->str);
+	free(b);
+}
+
+/**
+ * sym_batch_set_tristate - set the user value of a bool or tristate symbol
+ * @b: the batch
+ * @lane: the configuration
+ * @sym: the symbol
+ * @val: the value
+ *
+ * As when reading a .config, a choice member set last takes priority over the
+ * other members in the lane.
+ */
+void sym_batch_set_tristate(struct sym_batch *b, unsigned int lane,
+			    struct symbol *sym, tristate val)
+{
+	uint64_t bit = 1ULL << lane;
+
+	if (!batch_has_sym(b, sym))
+		return;
+
+	b->user_seq[sym->id * SYM_BATCH_LANES + lane] = ++b->seq;
+	b->has_user[sym->id] |= bit;
+	b->user[sym->id].m &= ~bit;
+	b->user[sym->id].y &= ~bit;
+	if (val >= mod)
+		b->user[sym->id].m |= bit;
+	if (val == yes)
+		b->user[sym->id].y |= bit;
+}
+
+/**
+ * sym_batch_set_string - set the user value of an int, hex or string symbol
+ * @b: the batch
+ * @lane: the configuration
+ * @sym: the symbol
+ * @val: the value, which has to stay valid as long as the batch is used
+ */
+void sym_batch_set_string(struct sym_batch *b, unsigned int lane,
+			  struct symbol *sym, const char *val)
+{
+	if (!batch_has_sym(b, sym))
+		return;
+
+	b->has_user[sym->id] |= 1ULL << lane;
+	b->user_str[sym->id * SYM_BATCH_LANES + lane] = val;
+}
+
+/**
+ * sym_batch_unset - remove the user value of a symbol
+ * @b: the batch
+ * @lane: the configuration
+ * @sym: the symbol
+ */
+void sym_batch_unset(struct sym_batch *b, unsigned int lane,
+		     struct symbol *sym)
+{
+	if (!batch_has_sym(b, sym))
+		return;
+
+	b->has_user[sym->id] &= ~(1ULL << lane);
+}
+
+/**
+ * sym_batch_get_user - get the user value of a symbol as a string
+ * @b: the batch
+ * @lane: the configuration
+ * @sym: the symbol
+ *
+ * Return: the user value, or NULL if the symbol has none in the lane.
+ */
+const char *sym_batch_get_user(struct sym_batch *b, unsigned int lane,
+			       struct symbol *sym)
+{
+	if (!batch_has_sym(b, sym) || !lane_test(b->has_user[sym->id], lane))
+		return NULL;
+
+	switch (sym->type) {
+	case S_BOOLEAN:
+	case S_TRISTATE:
+		switch (lanes_get(b->user[sym->id], lane)) {
+		case no:
+			return "n";
+		case mod:
+			return "m";
+		case yes:
+			return "y";
+		}
+		return NULL;
+	default:
+		return b->user_str[sym->id * SYM_BATCH_LANES + lane];
+	}
+}
+
+/**
+ * sym_batch_calc - calculate the symbol values of all configurations
+ * @b: the batch
+ */
+void sym_batch_calc(struct sym_batch *b)
+{
+	unsigned int nr = b->nr_syms;
+	struct symbol *sym;
+
+	/* the type of tristate symbols depends on the value of MODULES */
+	b->modules = ~0ULL;
+	for (int pass = 0; pass < 2; pass++) {
+		memset(b->state, BATCH_TODO, nr * sizeof(*b->state));
+		memset(b->choice_done, 0, nr * sizeof(*b->choice_done));
+		memset(b->val, 0, nr * sizeof(*b->val));
+		memset(b->visible, 0, nr * sizeof(*b->visible));
+		memset(b->unmet, 0, nr * sizeof(*b->unmet));
+
+		if (pass == 0) {
+			if (!modules_sym || !batch_has_sym(b, modules_sym))
+				continue;
+			batch_calc_sym(b, modules_sym);
+			b->modules = b->val[modules_sym->id].m;
+			continue;
+		}
+
+		for_all_symbols(sym)
+			if (batch_has_sym(b, sym))
+				batch_calc_sym(b, sym);
+	}
+}
+
+/**
+ * sym_batch_get_tristate - get the calculated tristate value of a symbol
+ * @b: the batch
+ * @lane: the configuration
+ * @sym: the symbol
+ */
+tristate sym_batch_get_tristate(struct sym_batch *b, unsigned int lane,
+				struct symbol *sym)
+{
+	struct tristate_lanes l;
+
+	sym_batch_lanes(b, sym, &l);
+	return lanes_get(l, lane);
+}
+
+/**
+ * sym_batch_get_string - get the calculated value of a symbol as a string
+ * @b: the batch
+ * @lane: the configuration
+ * @sym: the symbol
+ */
+const char *sym_batch_get_string(struct sym_batch *b, unsigned int lane,
+				 struct symbol *sym)
+{
+	return sym_batch_string(b, sym, lane);
+}
+
+/**
+ * sym_batch_get_visible - get the visibility of a symbol in all lanes
+ * @b: the batch
+ * @sym: the symbol
+ */
+struct tristate_lanes sym_batch_get_visible(struct sym_batch *b,
+					    struct symbol *sym)
+{
+	if (!batch_has_sym(b, sym))
+		return lanes_const(sym->visible);
+
+	return b->visible[sym->id];
+}
+
+/**
+ * sym_batch_get_unmet - get the lanes in which a symbol is selected beyond
+ *			 its direct dependencies
+ * @b: the batch
+ * @sym: the symbol
+ */
+uint64_t sym_batch_get_unmet(struct sym_batch *b, struct symbol *sym)
+{
+	if (!batch_has_sym(b, sym))
+		return 0;
+
+	return b->unmet[sym->id];
+}
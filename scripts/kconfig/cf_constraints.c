@@ -209,6 +209,7 @@ static void build_constraints_select(struct cfdata *data)
 	struct symbol *sym;
 
 	for_all_symbols(sym) {
+		struct sym_cfdata *cf = sym_cf(data, sym);
 		struct pexpr *sel_y, *sel_both;
 		struct pexpr *c1, *c2;
 
@@ -224,29 +225,29 @@ static void build_constraints_select(struct cfdata *data)
 		if (!sym->rev_dep.expr)
 			continue;
 
-		if (sym->list_sel_y == NULL)
+		if (cf->list_sel_y == NULL)
 			continue;
 
-		sel_y = pexpr_implies(pexpr_alloc_symbol(sym->fexpr_sel_y),
-				      pexpr_alloc_symbol(sym->fexpr_y), data,
+		sel_y = pexpr_implies(pexpr_alloc_symbol(cf->fexpr_sel_y),
+				      pexpr_alloc_symbol(cf->fexpr_y), data,
 				      PEXPR_ARGX);
 		sym_add_constraint(sym, sel_y, data);
 
-		c1 = pexpr_implies(pexpr_alloc_symbol(sym->fexpr_sel_y),
-				   sym->list_sel_y, data, PEXPR_ARG1);
+		c1 = pexpr_implies(pexpr_alloc_symbol(cf->fexpr_sel_y),
+				   cf->list_sel_y, data, PEXPR_ARG1);
 		sym_add_constraint(sym, c1, data);
 
 		/* only continue for tristates */
 		if (sym->type == S_BOOLEAN)
 			continue;
 
-		sel_both = pexpr_implies(pexpr_alloc_symbol(sym->fexpr_sel_both),
+		sel_both = pexpr_implies(pexpr_alloc_symbol(cf->fexpr_sel_both),
 					   sym_get_fexpr_both(sym, data), data,
 					   PEXPR_ARGX);
 		sym_add_constraint(sym, sel_both, data);
 
-		c2 = pexpr_implies(pexpr_alloc_symbol(sym->fexpr_sel_both),
-				   sym->list_sel_both, data, PEXPR_ARG1);
+		c2 = pexpr_implies(pexpr_alloc_symbol(cf->fexpr_sel_both),
+				   cf->list_sel_both, data, PEXPR_ARG1);
 		sym_add_constraint(sym, c2, data);
 		PEXPR_PUT(sel_y, sel_both, c1, c2);
 	}
@@ -290,21 +291,22 @@ static void build_constraints_nonbool(struct cfdata *data)
 static void build_tristate_constraint_clause(struct symbol *sym,
 					     struct cfdata *data)
 {
+	struct sym_cfdata *cf = sym_cf(data, sym);
 	struct pexpr *X_y, *X_both, *modules, *c;
 
 	if (sym->type != S_TRISTATE)
 		return;
 
-	X_y = pexpr_alloc_symbol(sym->fexpr_y);
-	X_both = pexpr_alloc_symbol(sym->fexpr_both);
-	modules = pexpr_alloc_symbol(modules_sym->fexpr_y);
+	X_y = pexpr_alloc_symbol(cf->fexpr_y);
+	X_both = pexpr_alloc_symbol(cf->fexpr_both);
+	modules = sym_get_fexpr_y(modules_sym, data);
 
 	/* X_y => X_both */
 	c = pexpr_implies_share(X_y, X_both, data);
 	sym_add_constraint(sym, c, data);
 
 	/* -MODULES -> -(X_both /\ -X_y) (<-> MODULE v -X_both v X_y) */
-	if (modules_sym->fexpr_y != NULL) {
+	if (sym_cf(data, modules_sym)->fexpr_y != NULL) {
 		struct pexpr *c2 =
 			pexpr_or(modules,
 				 pexpr_or(pexpr_not_share(X_both, data), X_y,
@@ -325,7 +327,8 @@ static void add_selects_kcr(struct symbol *sym, struct cfdata *data)
 {
 	struct pexpr *rdep_y = expr_calculate_pexpr_y(sym->rev_dep.expr, data);
 	struct pexpr *c1 = pexpr_implies(
-		rdep_y, pexpr_alloc_symbol(sym->fexpr_y), data, PEXPR_ARG2);
+		rdep_y, sym_get_fexpr_y(sym, data), data,
+		PEXPR_ARG2);
 
 	struct pexpr *rdep_both =
 		expr_calculate_pexpr_both(sym->rev_dep.expr, data);
@@ -350,6 +353,7 @@ static void add_selects(struct symbol *sym, struct cfdata *data)
 
 	for_all_properties(sym, p, P_SELECT) {
 		struct symbol *selected = p->expr->left.sym;
+		struct sym_cfdata *sel_cf = sym_cf(data, selected);
 		struct pexpr *cond_y, *cond_both;
 
 		if (selected->type == S_UNKNOWN)
@@ -375,16 +379,16 @@ static void add_selects(struct symbol *sym, struct cfdata *data)
 				cond_both, sym_get_fexpr_both(sym, data), data,
 				PEXPR_ARG2);
 			struct pexpr *c1 = pexpr_implies(
-				e1, pexpr_alloc_symbol(selected->fexpr_sel_y),
+				e1, pexpr_alloc_symbol(sel_cf->fexpr_sel_y),
 				data, PEXPR_ARG2);
 
 			sym_add_constraint(selected, c1, data);
 
-			if (selected->list_sel_y == NULL)
-				selected->list_sel_y = pexpr_get(e1);
+			if (sel_cf->list_sel_y == NULL)
+				sel_cf->list_sel_y = pexpr_get(e1);
 			else
-				selected->list_sel_y =
-					pexpr_or(selected->list_sel_y, e1, data,
+				sel_cf->list_sel_y =
+					pexpr_or(sel_cf->list_sel_y, e1, data,
 						 PEXPR_ARG1);
 			PEXPR_PUT(e1, c1);
 		}
@@ -393,33 +397,34 @@ static void add_selects(struct symbol *sym, struct cfdata *data)
 			struct pexpr *e2, *e3, *c2, *c3;
 
 			/* imply that symbol is selected to y */
-			e2 = pexpr_and(cond_y, pexpr_alloc_symbol(sym->fexpr_y),
+			e2 = pexpr_and(cond_y,
+				       sym_get_fexpr_y(sym, data),
 				       data, PEXPR_ARG2);
 			c2 = pexpr_implies(
-				e2, pexpr_alloc_symbol(selected->fexpr_sel_y),
+				e2, pexpr_alloc_symbol(sel_cf->fexpr_sel_y),
 				data, PEXPR_ARG2);
 			sym_add_constraint(selected, c2, data);
 
-			if (selected->list_sel_y == NULL)
-				selected->list_sel_y = pexpr_get(e2);
+			if (sel_cf->list_sel_y == NULL)
+				sel_cf->list_sel_y = pexpr_get(e2);
 			else
-				selected->list_sel_y =
-					pexpr_or(selected->list_sel_y, e2,
-						      data, PEXPR_ARG1);
+				sel_cf->list_sel_y =
+					pexpr_or(sel_cf->list_sel_y, e2,
+						 data, PEXPR_ARG1);
 
 			/* imply that symbol is selected to both */
 			e3 = pexpr_and(cond_both, sym_get_fexpr_both(sym, data),
 				       data, PEXPR_ARG2);
 			c3 = pexpr_implies(
-				e3, pexpr_alloc_symbol(selected->fexpr_sel_both),
+				e3, pexpr_alloc_symbol(sel_cf->fexpr_sel_both),
 				data, PEXPR_ARG2);
 			sym_add_constraint(selected, c3, data);
 
-			if (selected->list_sel_both == NULL)
-				selected->list_sel_both = pexpr_get(e3);
+			if (sel_cf->list_sel_both == NULL)
+				sel_cf->list_sel_both = pexpr_get(e3);
 			else
-				selected->list_sel_both =
-					pexpr_or(selected->list_sel_both, e3,
+				sel_cf->list_sel_both =
+					pexpr_or(sel_cf->list_sel_both, e3,
 						 data, PEXPR_ARG1);
 			PEXPR_PUT(e2, c2, e3, c3);
 		}
@@ -433,6 +438,7 @@ static void add_selects(struct symbol *sym, struct cfdata *data)
  */
 static void add_dependencies_bool(struct symbol *sym, struct cfdata *data)
 {
+	struct sym_cfdata *cf = sym_cf(data, sym);
 	struct pexpr *dep_both;
 	struct pexpr *visible_m;
 	struct pexpr *visible_y;
@@ -462,7 +468,7 @@ static void add_dependencies_bool(struct symbol *sym, struct cfdata *data)
 	dep_both = expr_calculate_pexpr_both(sym->dir_dep.expr, data);
 
 	sel_y = sym->rev_dep.expr ?
-			pexpr_alloc_symbol(sym->fexpr_sel_y) :
+			pexpr_alloc_symbol(cf->fexpr_sel_y) :
 			pexpr_alloc_symbol(data->constants->const_false);
 	has_prompt = pexpr_get(visible_both);
 	has_prompt = pexpr_and(
@@ -495,9 +501,9 @@ static void add_dependencies_bool(struct symbol *sym, struct cfdata *data)
 				      data, PEXPR_ARGX);
 		cond_m = pexpr_implies(has_prompt, pexpr_not_share(sel_y, data),
 				       data, PEXPR_ARG2);
-		c1 = pexpr_implies(pexpr_alloc_symbol(sym->fexpr_y), cond_y,
+		c1 = pexpr_implies(pexpr_alloc_symbol(cf->fexpr_y), cond_y,
 				   data, PEXPR_ARG1);
-		c2 = pexpr_implies(pexpr_alloc_symbol(sym->fexpr_both),
+		c2 = pexpr_implies(pexpr_alloc_symbol(cf->fexpr_both),
 				   cond_both, data, PEXPR_ARG1);
 		c3 = pexpr_implies(sym_get_fexpr_m(sym, data), cond_m, data,
 				   PEXPR_ARG1);
@@ -514,11 +520,11 @@ static void add_dependencies_bool(struct symbol *sym, struct cfdata *data)
 
 		cond1 = pexpr_implies(pexpr_not_share(has_prompt, data),
 				      pexpr_or(dep_both,
-					       pexpr_alloc_symbol(sym->fexpr_y),
+					       pexpr_alloc_symbol(cf->fexpr_y),
 					       data, PEXPR_ARG2),
 				      data, PEXPR_ARGX);
 		cond2 = pexpr_implies_share(has_prompt, visible_y, data);
-		c = pexpr_implies(pexpr_alloc_symbol(sym->fexpr_y),
+		c = pexpr_implies(pexpr_alloc_symbol(cf->fexpr_y),
 				  pexpr_and_share(cond1, cond2, data), data,
 				  PEXPR_ARGX);
 
@@ -535,6 +541,7 @@ static void add_dependencies_bool(struct symbol *sym, struct cfdata *data)
  */
 static void add_dependencies_bool_kcr(struct symbol *sym, struct cfdata *data)
 {
+	struct sym_cfdata *cf = sym_cf(data, sym);
 	struct pexpr *dep_both, *sel_both;
 
 	if (!sym_is_boolean(sym) || !sym->dir_dep.expr)
@@ -558,12 +565,12 @@ static void add_dependencies_bool_kcr(struct symbol *sym, struct cfdata *data)
 						sym->rev_dep.expr, data) :
 					pexpr_alloc_symbol(
 						data->constants->const_false);
-			c1 = pexpr_implies(pexpr_alloc_symbol(sym->fexpr_y),
+			c1 = pexpr_implies(pexpr_alloc_symbol(cf->fexpr_y),
 						pexpr_or(dep_y, sel_y,
 							      data, PEXPR_ARGX),
 						data, PEXPR_ARGX);
 		}
-		c2 = pexpr_implies(pexpr_alloc_symbol(sym->fexpr_both),
+		c2 = pexpr_implies(pexpr_alloc_symbol(cf->fexpr_both),
 					pexpr_or_share(dep_both, sel_both,
 						       data),
 					data, PEXPR_ARGX);
@@ -573,7 +580,7 @@ static void add_dependencies_bool_kcr(struct symbol *sym, struct cfdata *data)
 		PEXPR_PUT(c1, c2);
 	} else if (sym->type == S_BOOLEAN) {
 		struct pexpr *c = pexpr_implies(
-			pexpr_alloc_symbol(sym->fexpr_y),
+			pexpr_alloc_symbol(cf->fexpr_y),
 			pexpr_or_share(dep_both, sel_both, data), data,
 			PEXPR_ARGX);
 
@@ -604,7 +611,7 @@ static void add_dependencies_nonbool(struct symbol *sym, struct cfdata *data)
 
 	nb_vals = pexpr_alloc_symbol(data->constants->const_false);
 	/* can skip the first non-boolean value, since this is 'n' */
-	CF_LIST_FOR_EACH(node, sym->nb_vals, fexpr) {
+	CF_LIST_FOR_EACH(node, sym_cf(data, sym)->nb_vals, fexpr) {
 		if (first) {
 			first = false;
 			continue;
@@ -654,6 +661,7 @@ static void add_choice_prompt_cond(struct symbol *sym, struct cfdata *data)
  */
 static void add_choice_dependencies(struct symbol *sym, struct cfdata *data)
 {
+	struct sym_cfdata *cf = sym_cf(data, sym);
 	struct property *prompt;
 	struct expr *to_parse;
 	struct pexpr *dep_both;
@@ -680,10 +688,10 @@ static void add_choice_dependencies(struct symbol *sym, struct cfdata *data)
 	if (sym->type == S_TRISTATE) {
 		struct pexpr *dep_y = expr_calculate_pexpr_y(to_parse, data);
 		struct pexpr *c1 =
-			pexpr_implies(pexpr_alloc_symbol(sym->fexpr_y), dep_y,
+			pexpr_implies(pexpr_alloc_symbol(cf->fexpr_y), dep_y,
 				      data, PEXPR_ARG1);
 		struct pexpr *c2 =
-			pexpr_implies(pexpr_alloc_symbol(sym->fexpr_both),
+			pexpr_implies(pexpr_alloc_symbol(cf->fexpr_both),
 				      dep_both, data, PEXPR_ARG1);
 
 		sym_add_constraint_unique(sym, c1, data);
@@ -691,7 +699,7 @@ static void add_choice_dependencies(struct symbol *sym, struct cfdata *data)
 		PEXPR_PUT(dep_y, c1, c2);
 	} else if (sym->type == S_BOOLEAN) {
 		struct pexpr *c =
-			pexpr_implies(pexpr_alloc_symbol(sym->fexpr_y),
+			pexpr_implies(pexpr_alloc_symbol(cf->fexpr_y),
 				      dep_both, data, PEXPR_ARG1);
 
 		sym_add_constraint_unique(sym, c, data);
@@ -735,15 +743,18 @@ static void add_choice_constraints(struct symbol *sym, struct cfdata *data)
 	/* if the choice is set to yes, at least one child must be set to yes */
 	c1 = NULL;
 	CF_LIST_FOR_EACH(node, promptItems, sym) {
+		struct pexpr *choice_y;
+
 		choice = node->elem;
+		choice_y = sym_get_fexpr_y(choice, data);
+
 		c1 = list_is_head(node->node.prev, &promptItems->list) ?
-			     pexpr_alloc_symbol(choice->fexpr_y) :
-			     pexpr_or(c1, pexpr_alloc_symbol(choice->fexpr_y),
-				      data, PEXPR_ARGX);
+			     choice_y :
+			     pexpr_or(c1, choice_y, data, PEXPR_ARGX);
 	}
 	if (c1 != NULL) {
 		struct pexpr *c2 = pexpr_implies(
-			pexpr_alloc_symbol(sym->fexpr_y), c1, data, PEXPR_ARG1);
+			sym_get_fexpr_y(sym, data), c1, data, PEXPR_ARG1);
 
 		sym_add_constraint(sym, c2, data);
 		PEXPR_PUT(c1, c2);
@@ -767,13 +778,15 @@ static void add_choice_constraints(struct symbol *sym, struct cfdata *data)
 
 		choice = node->elem;
 		list_for_each_entry_from(node2, &promptItems->list, node) {
+			struct fexpr *y1, *y2;
+
 			choice2 = node2->elem;
-			c1 = pexpr_or(
-				pexpr_not(pexpr_alloc_symbol(choice->fexpr_y),
-					  data),
-				pexpr_not(pexpr_alloc_symbol(choice2->fexpr_y),
-					  data),
-				data, PEXPR_ARGX);
+			y1 = sym_cf(data, choice)->fexpr_y;
+			y2 = sym_cf(data, choice2)->fexpr_y;
+
+			c1 = pexpr_or(pexpr_not(pexpr_alloc_symbol(y1), data),
+				      pexpr_not(pexpr_alloc_symbol(y2), data),
+				      data, PEXPR_ARGX);
 			sym_add_constraint(sym, c1, data);
 			pexpr_put(c1);
 		}
@@ -787,6 +800,7 @@ static void add_choice_constraints(struct symbol *sym, struct cfdata *data)
  */
 static void add_invisible_constraints(struct symbol *sym, struct cfdata *data)
 {
+	struct sym_cfdata *cf = sym_cf(data, sym);
 	struct property *prompt = sym_get_prompt(sym);
 	struct pexpr *promptCondition_both, *promptCondition_yes, *noPromptCond;
 	struct pexpr *npc;
@@ -835,7 +849,7 @@ static void add_invisible_constraints(struct symbol *sym, struct cfdata *data)
 
 		str_append(&npc_fe->name, sym_get_name(sym));
 		str_append(&npc_fe->name, "_NPC");
-		sym->noPromptCond = npc_fe;
+		cf->noPromptCond = npc_fe;
 		fexpr_add_to_satmap(npc_fe, data);
 
 		npc = pexpr_alloc_symbol(npc_fe);
@@ -862,7 +876,7 @@ static void add_invisible_constraints(struct symbol *sym, struct cfdata *data)
 	if (sym->type == S_TRISTATE) {
 		struct pexpr *e1 = pexpr_implies(
 			promptCondition_both,
-			pexpr_implies(pexpr_alloc_symbol(sym->fexpr_y),
+			pexpr_implies(pexpr_alloc_symbol(cf->fexpr_y),
 					   promptCondition_yes, data,
 					   PEXPR_ARG1),
 			data, PEXPR_ARG2);
@@ -879,25 +893,25 @@ static void add_invisible_constraints(struct symbol *sym, struct cfdata *data)
 		struct pexpr *c1, *c2, *c3;
 		struct pexpr *d1, *d2;
 
-		if (sym->fexpr_sel_y != NULL) {
+		if (cf->fexpr_sel_y != NULL) {
 			sel_y = pexpr_implies(
-				pexpr_alloc_symbol(sym->fexpr_y),
-				pexpr_alloc_symbol(sym->fexpr_sel_y), data,
+				pexpr_alloc_symbol(cf->fexpr_y),
+				pexpr_alloc_symbol(cf->fexpr_sel_y), data,
 				PEXPR_ARGX);
 			sel_both = pexpr_implies(
-				pexpr_alloc_symbol(sym->fexpr_both),
-				pexpr_alloc_symbol(sym->fexpr_sel_both), data,
+				pexpr_alloc_symbol(cf->fexpr_both),
+				pexpr_alloc_symbol(cf->fexpr_sel_both), data,
 				PEXPR_ARGX);
 		} else {
-			sel_y = pexpr_not(pexpr_alloc_symbol(sym->fexpr_y),
+			sel_y = pexpr_not(pexpr_alloc_symbol(cf->fexpr_y),
 					  data);
-			sel_both = pexpr_not(pexpr_alloc_symbol(sym->fexpr_both),
+			sel_both = pexpr_not(pexpr_alloc_symbol(cf->fexpr_both),
 					  data);
 		}
 
 		c1 = pexpr_implies(pexpr_not_share(default_y, data), sel_y,
 				   data, PEXPR_ARG1);
-		c2 = pexpr_implies(pexpr_alloc_symbol(modules_sym->fexpr_y), c1,
+		c2 = pexpr_implies(sym_get_fexpr_y(modules_sym, data), c1,
 				   data, PEXPR_ARG1);
 		c3 = pexpr_implies_share(npc, c2, data);
 		sym_add_constraint(sym, c3, data);
@@ -911,13 +925,13 @@ static void add_invisible_constraints(struct symbol *sym, struct cfdata *data)
 		struct pexpr *sel_y;
 		struct pexpr *e1, *e2;
 
-		if (sym->fexpr_sel_y != NULL)
+		if (cf->fexpr_sel_y != NULL)
 			sel_y = pexpr_implies(
-				pexpr_alloc_symbol(sym->fexpr_y),
-				pexpr_alloc_symbol(sym->fexpr_sel_y), data,
+				pexpr_alloc_symbol(cf->fexpr_y),
+				pexpr_alloc_symbol(cf->fexpr_sel_y), data,
 				PEXPR_ARGX);
 		else
-			sel_y = pexpr_not(pexpr_alloc_symbol(sym->fexpr_y),
+			sel_y = pexpr_not(pexpr_alloc_symbol(cf->fexpr_y),
 					  data);
 
 		e1 = pexpr_implies(pexpr_not_share(default_both, data),
@@ -938,7 +952,7 @@ static void add_invisible_constraints(struct symbol *sym, struct cfdata *data)
 		bool first = true;
 
 		/* e1 = "sym is not set" */
-		CF_LIST_FOR_EACH(node, sym->nb_vals, fexpr) {
+		CF_LIST_FOR_EACH(node, cf->nb_vals, fexpr) {
 			if (first) {
 				first = false;
 				continue;
@@ -969,7 +983,7 @@ static void add_invisible_constraints(struct symbol *sym, struct cfdata *data)
 		e1 = pexpr_implies(
 			npc,
 			pexpr_implies(default_y,
-				      pexpr_alloc_symbol(sym->fexpr_y), data,
+				      pexpr_alloc_symbol(cf->fexpr_y), data,
 				      PEXPR_ARG2),
 			data, PEXPR_ARG2);
 		sym_add_constraint(sym, e1, data);
@@ -987,7 +1001,7 @@ static void add_invisible_constraints(struct symbol *sym, struct cfdata *data)
 		struct pexpr *c2;
 
 		c = pexpr_implies(default_both,
-				  pexpr_alloc_symbol(sym->fexpr_y), data,
+				  pexpr_alloc_symbol(cf->fexpr_y), data,
 				  PEXPR_ARG2);
 
 		// TODO tristate choice hack
@@ -1109,7 +1123,7 @@ static void sym_add_range_constraints(struct symbol *sym, struct cfdata *data)
 
 		first = true;
 		/* can skip the first non-boolean value, since this is 'n' */
-		CF_LIST_FOR_EACH(node, sym->nb_vals, fexpr) {
+		CF_LIST_FOR_EACH(node, sym_cf(data, sym)->nb_vals, fexpr) {
 			struct pexpr *not_nb_val;
 			struct pexpr *c;
 
@@ -1149,7 +1163,7 @@ static void sym_nonbool_at_least_1(struct symbol *sym, struct cfdata *data)
 		return;
 
 	e = pexpr_alloc_symbol(data->constants->const_false);
-	CF_LIST_FOR_EACH(node, sym->nb_vals, fexpr)
+	CF_LIST_FOR_EACH(node, sym_cf(data, sym)->nb_vals, fexpr)
 		e = pexpr_or(e, pexpr_alloc_symbol(node->elem), data,
 			     PEXPR_ARGX);
 
@@ -1162,17 +1176,18 @@ static void sym_nonbool_at_least_1(struct symbol *sym, struct cfdata *data)
  */
 static void sym_nonbool_at_most_1(struct symbol *sym, struct cfdata *data)
 {
+	struct sym_cfdata *cf = sym_cf(data, sym);
 	struct fexpr_node *node1;
 
 	if (!sym_is_nonboolean(sym))
 		return;
 
 	/* iterate over all subsets of sym->nb_vals of size 2 */
-	CF_LIST_FOR_EACH(node1, sym->nb_vals, fexpr) {
+	CF_LIST_FOR_EACH(node1, cf->nb_vals, fexpr) {
 		struct pexpr *e1 = pexpr_alloc_symbol(node1->elem);
 		struct fexpr_node *node2;
 
-		list_for_each_entry_reverse(node2, &sym->nb_vals->list, node) {
+		list_for_each_entry_reverse(node2, &cf->nb_vals->list, node) {
 			struct pexpr *e2, *e;
 
 			if (node2 == node1)
@@ -1205,7 +1220,7 @@ static void sym_add_nonbool_prompt_constraint(struct symbol *sym,
 		return;
 
 	promptCondition = prop_get_condition(prompt, data);
-	n = pexpr_alloc_symbol(sym_get_nonbool_fexpr(sym, "n"));
+	n = pexpr_alloc_symbol(sym_get_nonbool_fexpr(sym, "n", data));
 
 	if (n->type != PE_SYMBOL || n->left.fexpr == NULL)
 		goto cleanup;
@@ -1616,7 +1631,7 @@ static long sym_get_range_val(struct symbol *sym, int base)
 /*
  * count the number of all constraints
  */
-unsigned int count_constraints(void)
+unsigned int count_constraints(struct cfdata *data)
 {
 	unsigned int c = 0;
 	struct symbol *sym;
@@ -1625,7 +1640,7 @@ unsigned int count_constraints(void)
 		if (sym->type == S_UNKNOWN)
 			continue;
 
-		c += list_count_nodes(&sym->constraints->list);
+		c += list_count_nodes(&sym_cf(data, sym)->constraints->list);
 	}
 
 	return c;
@@ -1650,7 +1665,8 @@ void sym_add_constraint(struct symbol *sym, struct pexpr *constraint,
 	    constraint->left.fexpr == data->constants->const_false)
 		perror("Adding const_false.");
 
-	CF_PUSH_BACK(sym->constraints, pexpr_get(constraint), pexpr);
+	CF_PUSH_BACK(sym_cf(data, sym)->constraints, pexpr_get(constraint),
+		     pexpr);
 }
 
 /*
@@ -1659,6 +1675,7 @@ void sym_add_constraint(struct symbol *sym, struct pexpr *constraint,
 void sym_add_constraint_unique(struct symbol *sym, struct pexpr *constraint,
 			   struct cfdata *data)
 {
+	struct sym_cfdata *cf = sym_cf(data, sym);
 	struct pexpr_node *node;
 
 	if (!constraint)
@@ -1675,9 +1692,9 @@ void sym_add_constraint_unique(struct symbol *sym, struct pexpr *constraint,
 		perror("Adding const_false.");
 
 	/* check the constraints for the same symbol */
-	CF_LIST_FOR_EACH(node, sym->constraints, pexpr)
+	CF_LIST_FOR_EACH(node, cf->constraints, pexpr)
 		if (pexpr_test_eq(constraint, node->elem, data))
 			return;
 
-	CF_PUSH_BACK(sym->constraints, pexpr_get(constraint), pexpr);
+	CF_PUSH_BACK(cf->constraints, pexpr_get(constraint), pexpr);
 }
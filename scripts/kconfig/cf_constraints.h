@@ -13,7 +13,7 @@
 void build_constraints(struct cfdata *data);
 
 /* count the number of all constraints */
-unsigned int count_constraints(void);
+unsigned int count_constraints(struct cfdata *data);
 
 /* add a constraint for a symbol */
 void sym_add_constraint(struct symbol *sym, struct pexpr *constraint, struct cfdata *data);
@@ -386,6 +386,20 @@ struct constants {
 	struct fexpr *symbol_no_fexpr;
 };
 
+/*
+ * CNF-clauses as added to PicoSAT, in CSR form: the literals of clause i are
+ * lits[clause_start[i]] up to lits[clause_start[i + 1] - 1]
+ */
+struct cnf_store {
+	int *lits;
+	size_t lits_nr;
+	size_t lits_size;
+	size_t *clause_start; // nr_clauses + 1 entries
+	struct symbol **clause_sym; // symbol the clause belongs to, NULL for constants
+	size_t nr_clauses;
+	size_t clauses_size;
+};
+
 struct cfdata {
 	unsigned int sat_variable_nr;
 	unsigned int tmp_variable_nr;
@@ -393,6 +407,50 @@ struct cfdata {
 	size_t satmap_size;
 	struct constants *constants;
 	struct sdv_list *sdv_symbols; // array with conflict-symbols
+	struct cnf_store cnf; // all clauses added to PicoSAT
+	int *assumptions; // assumed literal for each SAT variable, 0 for none
+	size_t assumptions_size;
+	unsigned long *sdv_bits; // SAT variables of the conflict-symbols
+	struct sym_cfdata *syms; // per symbol, see sym_cf()
+	unsigned int syms_nr;
 };
 
+/*
+ * ConfigFix state of a symbol
+ */
+struct sym_cfdata {
+	struct fexpr *fexpr_y;
+	struct fexpr *fexpr_both;
+	struct fexpr *fexpr_sel_y;
+	struct fexpr *fexpr_sel_both;
+	struct pexpr *list_sel_y;
+	struct pexpr *list_sel_both;
+	struct fexpr *noPromptCond;
+	struct fexpr_list *nb_vals; /* list of struct fexpr_node's; used for non-booleans */
+	struct pexpr_list *constraints; /* list of constraints for symbol */
+};
+
+/*
+ * The entries of data->syms are indexed by symbol::id. symbol_yes, symbol_mod
+ * and symbol_no are not in sym_array and share id 0, so they get the three
+ * entries after the last symbol.
+ */
+static inline struct sym_cfdata *sym_cf(struct cfdata *data,
+					struct symbol *sym)
+{
+	unsigned int i = sym->id;
+
+	if (i == 0) {
+		unsigned int nr = data->syms_nr - 3;
+
+		if (sym == &symbol_yes)
+			i = nr;
+		else if (sym == &symbol_mod)
+			i = nr + 1;
+		else if (sym == &symbol_no)
+			i = nr + 2;
+	}
+	return &data->syms[i];
+}
+
 #endif
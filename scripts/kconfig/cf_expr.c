@@ -75,6 +75,7 @@ void sym_create_fexpr(struct symbol *sym, struct cfdata *data)
  */
 static void create_fexpr_selected(struct symbol *sym, struct cfdata *data)
 {
+	struct sym_cfdata *cf = sym_cf(data, sym);
 	struct fexpr *fexpr_sel_y;
 	struct fexpr *fexpr_sel_both;
 
@@ -85,7 +86,7 @@ static void create_fexpr_selected(struct symbol *sym, struct cfdata *data)
 	fexpr_sel_y->sym = sym;
 	fexpr_add_to_satmap(fexpr_sel_y, data);
 
-	sym->fexpr_sel_y = fexpr_sel_y;
+	cf->fexpr_sel_y = fexpr_sel_y;
 
 	/* fexpr_sel_both */
 	if (sym->type == S_BOOLEAN)
@@ -97,7 +98,7 @@ static void create_fexpr_selected(struct symbol *sym, struct cfdata *data)
 	fexpr_sel_both->sym = sym;
 	fexpr_add_to_satmap(fexpr_sel_both, data);
 
-	sym->fexpr_sel_both = fexpr_sel_both;
+	cf->fexpr_sel_both = fexpr_sel_both;
 }
 
 /*
@@ -105,6 +106,7 @@ static void create_fexpr_selected(struct symbol *sym, struct cfdata *data)
  */
 static void create_fexpr_bool(struct symbol *sym, struct cfdata *data)
 {
+	struct sym_cfdata *cf = sym_cf(data, sym);
 	struct fexpr *fexpr_y;
 	struct fexpr *fexpr_both;
 
@@ -113,7 +115,7 @@ static void create_fexpr_bool(struct symbol *sym, struct cfdata *data)
 	fexpr_y->tri = yes;
 	fexpr_add_to_satmap(fexpr_y, data);
 
-	sym->fexpr_y = fexpr_y;
+	cf->fexpr_y = fexpr_y;
 
 
 	if (sym->type == S_TRISTATE) {
@@ -127,7 +129,7 @@ static void create_fexpr_bool(struct symbol *sym, struct cfdata *data)
 		fexpr_both = data->constants->const_false;
 	}
 
-	sym->fexpr_both = fexpr_both;
+	cf->fexpr_both = fexpr_both;
 
 	if (sym->rev_dep.expr)
 		create_fexpr_selected(sym, data);
@@ -138,15 +140,16 @@ static void create_fexpr_bool(struct symbol *sym, struct cfdata *data)
  */
 static void create_fexpr_nonbool(struct symbol *sym, struct cfdata *data)
 {
+	struct sym_cfdata *cf = sym_cf(data, sym);
 	/* default values */
 	char int_values[][2] = {"n", "0", "1"};
 	char hex_values[][4] = {"n", "0x0", "0x1"};
 	char string_values[][9] = {"n", "", "nonempty"};
 
-	sym->fexpr_y = data->constants->const_false;
-	sym->fexpr_both = data->constants->const_false;
-	sym->nb_vals = xmalloc(sizeof(*sym->nb_vals));
-	INIT_LIST_HEAD(&sym->nb_vals->list);
+	cf->fexpr_y = data->constants->const_false;
+	cf->fexpr_both = data->constants->const_false;
+	cf->nb_vals = xmalloc(sizeof(*cf->nb_vals));
+	INIT_LIST_HEAD(&cf->nb_vals->list);
 
 	for (int i = 0; i < 3; i++) {
 		struct fexpr *e = fexpr_create(data->sat_variable_nr++,
@@ -173,7 +176,7 @@ static void create_fexpr_nonbool(struct symbol *sym, struct cfdata *data)
 			break;
 		}
 
-		CF_PUSH_BACK(sym->nb_vals, e, fexpr);
+		CF_PUSH_BACK(cf->nb_vals, e, fexpr);
 		fexpr_add_to_satmap(e, data);
 	}
 }
@@ -183,8 +186,10 @@ static void create_fexpr_nonbool(struct symbol *sym, struct cfdata *data)
  */
 static void create_fexpr_unknown(struct symbol *sym, struct cfdata *data)
 {
-	sym->fexpr_y = data->constants->const_false;
-	sym->fexpr_both = data->constants->const_false;
+	struct sym_cfdata *cf = sym_cf(data, sym);
+
+	cf->fexpr_y = data->constants->const_false;
+	cf->fexpr_both = data->constants->const_false;
 }
 
 /*
@@ -192,6 +197,7 @@ static void create_fexpr_unknown(struct symbol *sym, struct cfdata *data)
  */
 static void create_fexpr_choice(struct symbol *sym, struct cfdata *data)
 {
+	struct sym_cfdata *cf = sym_cf(data, sym);
 	struct property *prompt;
 	char *name, *write, *read;
 	struct fexpr *fexpr_y;
@@ -222,7 +228,7 @@ static void create_fexpr_choice(struct symbol *sym, struct cfdata *data)
 	fexpr_y->tri = yes;
 	fexpr_add_to_satmap(fexpr_y, data);
 
-	sym->fexpr_y = fexpr_y;
+	cf->fexpr_y = fexpr_y;
 
 	if (sym->type == S_TRISTATE) {
 		fexpr_both = fexpr_create(data->sat_variable_nr++, FE_CHOICE,
@@ -235,7 +241,7 @@ static void create_fexpr_choice(struct symbol *sym, struct cfdata *data)
 	} else {
 		fexpr_both = data->constants->const_false;
 	}
-	sym->fexpr_both = fexpr_both;
+	cf->fexpr_both = fexpr_both;
 	free(name);
 }
 
@@ -272,7 +278,7 @@ static struct pexpr *expr_eval_unequal_nonbool_const(struct symbol *sym,
 	c = pexpr_alloc_symbol(data->constants->const_false);
 	val = strtol(compval->name, NULL, base);
 	first = true;
-	CF_LIST_FOR_EACH(node, sym->nb_vals, fexpr) {
+	CF_LIST_FOR_EACH(node, sym_cf(data, sym)->nb_vals, fexpr) {
 		long symval;
 
 		if (first) {
@@ -338,13 +344,13 @@ static struct pexpr *expr_eval_unequal_bool(struct symbol *left,
 			c = pexpr_or(
 				c,
 				pexpr_and(sym_get_fexpr_m(left, data),
-					  pexpr_alloc_symbol(right->fexpr_y),
+					  sym_get_fexpr_y(right, data),
 					  data, PEXPR_ARGX),
 				data, PEXPR_ARGX);
 		break;
 	case E_LEQ:
-		c = pexpr_and(pexpr_alloc_symbol(left->fexpr_y),
-			      pexpr_alloc_symbol(right->fexpr_y), data,
+		c = pexpr_and(sym_get_fexpr_y(left, data),
+			      sym_get_fexpr_y(right, data), data,
 			      PEXPR_ARGX);
 		if (left->type == S_TRISTATE)
 			c = pexpr_or(c,
@@ -362,14 +368,14 @@ static struct pexpr *expr_eval_unequal_bool(struct symbol *left,
 		if (right->type == S_TRISTATE)
 			c = pexpr_or(
 				c,
-				pexpr_and(pexpr_alloc_symbol(left->fexpr_y),
+				pexpr_and(sym_get_fexpr_y(left, data),
 					  sym_get_fexpr_m(right, data),
 					  data, PEXPR_ARGX),
 				data, PEXPR_ARGX);
 		break;
 	case E_GEQ:
-		c = pexpr_and(pexpr_alloc_symbol(left->fexpr_y),
-			      pexpr_alloc_symbol(right->fexpr_y), data,
+		c = pexpr_and(sym_get_fexpr_y(left, data),
+			      sym_get_fexpr_y(right, data), data,
 			      PEXPR_ARGX);
 		if (right->type == S_TRISTATE)
 			c = pexpr_or(
@@ -403,7 +409,8 @@ struct pexpr *expr_calculate_pexpr_both(struct expr *e, struct cfdata *data)
 
 	switch (e->type) {
 	case E_SYMBOL:
-		return pexpr_alloc_symbol(e->left.sym->fexpr_both);
+		return pexpr_alloc_symbol(
+			sym_cf(data, e->left.sym)->fexpr_both);
 	case E_AND:
 		return expr_calculate_pexpr_both_and(e->left.expr,
 						     e->right.expr, data);
@@ -439,7 +446,7 @@ struct pexpr *expr_calculate_pexpr_y(struct expr *e, struct cfdata *data)
 
 	switch (e->type) {
 	case E_SYMBOL:
-		return pexpr_alloc_symbol(e->left.sym->fexpr_y);
+		return sym_get_fexpr_y(e->left.sym, data);
 	case E_AND:
 		return expr_calculate_pexpr_y_and(e->left.expr, e->right.expr,
 						  data);
@@ -555,10 +562,11 @@ static struct pexpr *equiv_pexpr_move(struct pexpr *a, struct pexpr *b,
 struct fexpr *sym_create_nonbool_fexpr(struct symbol *sym, char *value,
 				       struct cfdata *data)
 {
+	struct sym_cfdata *cf = sym_cf(data, sym);
 	struct fexpr *e;
 	char *s;
 	struct fexpr_node *first =
-		list_first_entry(&sym->nb_vals->list, struct fexpr_node, node);
+		list_first_entry(&cf->nb_vals->list, struct fexpr_node, node);
 
 	if (!strcmp(value, "")) {
 		if (sym->type == S_STRING)
@@ -567,7 +575,7 @@ struct fexpr *sym_create_nonbool_fexpr(struct symbol *sym, char *value,
 			return first->elem;
 	}
 
-	e = sym_get_nonbool_fexpr(sym, value);
+	e = sym_get_nonbool_fexpr(sym, value, data);
 
 	/* fexpr already exists */
 	if (e != NULL)
@@ -598,7 +606,7 @@ struct fexpr *sym_create_nonbool_fexpr(struct symbol *sym, char *value,
 			return first->elem;
 	}
 
-	e = sym_get_nonbool_fexpr(sym, s);
+	e = sym_get_nonbool_fexpr(sym, s, data);
 	if (e != NULL)
 		return e;
 
@@ -609,7 +617,7 @@ struct fexpr *sym_create_nonbool_fexpr(struct symbol *sym, char *value,
 	e->nb_val = str_new();
 	str_append(&e->nb_val, s);
 
-	CF_PUSH_BACK(sym->nb_vals, e, fexpr);
+	CF_PUSH_BACK(cf->nb_vals, e, fexpr);
 	fexpr_add_to_satmap(e, data);
 
 	return e;
@@ -619,11 +627,12 @@ struct fexpr *sym_create_nonbool_fexpr(struct symbol *sym, char *value,
  * return the fexpr of a non-boolean symbol for a specific value, NULL if
  * non-existent
  */
-struct fexpr *sym_get_nonbool_fexpr(struct symbol *sym, char *value)
+struct fexpr *sym_get_nonbool_fexpr(struct symbol *sym, char *value,
+				    struct cfdata *data)
 {
 	struct fexpr_node *e;
 
-	CF_LIST_FOR_EACH(e, sym->nb_vals, fexpr) {
+	CF_LIST_FOR_EACH(e, sym_cf(data, sym)->nb_vals, fexpr) {
 		if (strcmp(str_get(&e->elem->nb_val), value) == 0)
 			return e->elem;
 	}
@@ -638,7 +647,7 @@ struct fexpr *sym_get_nonbool_fexpr(struct symbol *sym, char *value)
 struct fexpr *sym_get_or_create_nonbool_fexpr(struct symbol *sym, char *value,
 					      struct cfdata *data)
 {
-	struct fexpr *e = sym_get_nonbool_fexpr(sym, value);
+	struct fexpr *e = sym_get_nonbool_fexpr(sym, value, data);
 
 	if (e != NULL)
 		return e;
@@ -670,8 +679,8 @@ struct pexpr *expr_calculate_pexpr_y_equals(struct expr *e, struct cfdata *data)
 	if (sym_is_bool_or_triconst(e->left.sym) &&
 	    sym_is_bool_or_triconst(e->right.sym)) {
 		struct pexpr *yes = equiv_pexpr_move(
-			pexpr_alloc_symbol(e->left.sym->fexpr_y),
-			pexpr_alloc_symbol(e->right.sym->fexpr_y), data,
+			sym_get_fexpr_y(e->left.sym, data),
+			sym_get_fexpr_y(e->right.sym, data), data,
 			PEXPR_ARGX);
 		struct pexpr *mod = equiv_pexpr_move(
 			sym_get_fexpr_m(e->left.sym, data),
@@ -704,11 +713,13 @@ struct pexpr *expr_calculate_pexpr_y_equals(struct expr *e, struct cfdata *data)
 	if (sym_is_nonboolean(e->left.sym) && sym_is_nonboolean(e->right.sym)) {
 		struct pexpr *c =
 			pexpr_alloc_symbol(data->constants->const_false);
+		struct fexpr_list *vals1 = sym_cf(data, e->left.sym)->nb_vals;
+		struct fexpr_list *vals2 = sym_cf(data, e->right.sym)->nb_vals;
 		struct fexpr *e1, *e2;
 		struct fexpr_node *node1, *node2;
 		bool first1 = true;
 
-		CF_LIST_FOR_EACH(node1, e->left.sym->nb_vals, fexpr) {
+		CF_LIST_FOR_EACH(node1, vals1, fexpr) {
 			bool first2 = true;
 
 			if (first1) {
@@ -716,7 +727,7 @@ struct pexpr *expr_calculate_pexpr_y_equals(struct expr *e, struct cfdata *data)
 				continue;
 			}
 			e1 = node1->elem;
-			CF_LIST_FOR_EACH(node2, e->right.sym->nb_vals, fexpr)
+			CF_LIST_FOR_EACH(node2, vals2, fexpr)
 			{
 				if (first2) {
 					first2 = false;
@@ -1153,14 +1164,24 @@ bool pexpr_is_cnf(struct pexpr *e)
 	return false;
 }
 
+/*
+ * return fexpr_y for a symbol
+ */
+struct pexpr *sym_get_fexpr_y(struct symbol *sym, struct cfdata *data)
+{
+	return pexpr_alloc_symbol(sym_cf(data, sym)->fexpr_y);
+}
+
 /*
  * return fexpr_both for a symbol
  */
 struct pexpr *sym_get_fexpr_both(struct symbol *sym, struct cfdata *data)
 {
+	struct sym_cfdata *cf = sym_cf(data, sym);
+
 	return sym->type == S_TRISTATE ?
-		       pexpr_alloc_symbol(sym->fexpr_both) :
-		       pexpr_alloc_symbol(sym->fexpr_y);
+		       pexpr_alloc_symbol(cf->fexpr_both) :
+		       pexpr_alloc_symbol(cf->fexpr_y);
 }
 
 /*
@@ -1168,9 +1189,11 @@ struct pexpr *sym_get_fexpr_both(struct symbol *sym, struct cfdata *data)
  */
 struct pexpr *sym_get_fexpr_m(struct symbol *sym, struct cfdata *data)
 {
+	struct sym_cfdata *cf = sym_cf(data, sym);
+
 	return sym->type == S_TRISTATE ?
-		       pexpr_and(pexpr_alloc_symbol(sym->fexpr_both),
-				 pexpr_not(pexpr_alloc_symbol(sym->fexpr_y),
+		       pexpr_and(pexpr_alloc_symbol(cf->fexpr_both),
+				 pexpr_not(pexpr_alloc_symbol(cf->fexpr_y),
 					   data),
 				 data, PEXPR_ARGX) :
 		       pexpr_alloc_symbol(data->constants->const_false);
@@ -1181,12 +1204,14 @@ struct pexpr *sym_get_fexpr_m(struct symbol *sym, struct cfdata *data)
  */
 struct pexpr *sym_get_fexpr_sel_both(struct symbol *sym, struct cfdata *data)
 {
+	struct sym_cfdata *cf = sym_cf(data, sym);
+
 	if (!sym->rev_dep.expr)
 		return pexpr_alloc_symbol(data->constants->const_false);
 
 	return sym->type == S_TRISTATE ?
-		       pexpr_alloc_symbol(sym->fexpr_sel_both) :
-		       pexpr_alloc_symbol(sym->fexpr_sel_y);
+		       pexpr_alloc_symbol(cf->fexpr_sel_both) :
+		       pexpr_alloc_symbol(cf->fexpr_sel_y);
 }
 
 /*
@@ -65,6 +65,9 @@ struct pexpr *pexpr_not(struct pexpr *a, struct cfdata *data);
 /* check whether a pexpr is in CNF */
 bool pexpr_is_cnf(struct pexpr *e);
 
+/* return fexpr_y for a symbol */
+struct pexpr *sym_get_fexpr_y(struct symbol *sym, struct cfdata *data);
+
 /* return fexpr_both for a symbol */
 struct pexpr *sym_get_fexpr_both(struct symbol *sym, struct cfdata *data);
 
@@ -82,7 +85,8 @@ struct fexpr *sym_create_nonbool_fexpr(struct symbol *sym, char *value,
  * return the fexpr of a non-boolean symbol for a specific value, NULL if
  * non-existent
  */
-struct fexpr *sym_get_nonbool_fexpr(struct symbol *sym, char *value);
+struct fexpr *sym_get_nonbool_fexpr(struct symbol *sym, char *value,
+				    struct cfdata *data);
 
 /*
  * return the fexpr of a non-boolean symbol for a specific value, if it exists
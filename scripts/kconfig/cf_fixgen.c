@@ -5,6 +5,7 @@
 
 #define _GNU_SOURCE
 #include <assert.h>
+#include <limits.h>
 #include <locale.h>
 #include <stdarg.h>
 #include <stdbool.h>
@@ -24,6 +25,7 @@
 #include "cf_fixgen.h"
 #include "internal.h"
 #include "cf_utils.h"
+#include "cf_portfolio.h"
 #include "cf_defs.h"
 
 #define MAX_DIAGNOSES 3
@@ -33,17 +35,24 @@
 #define PRINT_DIAGNOSIS_FOUND true
 #define MINIMISE_DIAGNOSES false
 #define MINIMISE_UNSAT_CORE true
+/* weights for changing a symbol, used for minimum-weight diagnoses */
+#define FIX_WEIGHT_DEFAULT 1
+#define FIX_WEIGHT_USER 4
 
 static struct sfl_list *diagnoses_symbol;
 
 static struct fexl_list *generate_diagnoses(PicoSAT *pico, struct cfdata *data,
 					    enum fixgen_exit_status *status);
+static struct fexl_list *generate_min_diagnoses(PicoSAT *pico,
+						struct cfdata *data,
+						enum fixgen_exit_status *status);
 
 static void add_fexpr_to_constraint_set(struct fexpr_list *C,
 					struct cfdata *data);
 static void set_assumptions(PicoSAT *pico, struct fexpr_list *c,
 			    struct cfdata *data);
-static void fexpr_add_assumption(PicoSAT *pico, struct fexpr *e, int satval);
+static void fexpr_add_assumption(PicoSAT *pico, struct fexpr *e,
+				 struct cfdata *data);
 static struct fexpr_list *get_unsat_core_soft(PicoSAT *pico,
 					      struct cfdata *data);
 static void minimise_unsat_core(PicoSAT *pico, struct fexpr_list *C,
@@ -72,13 +81,15 @@ static struct sfix_list *convert_diagnosis(struct fexpr_list *diagnosis,
 					   struct cfdata *data);
 static struct symbol_fix *symbol_fix_create(struct fexpr *e,
 					    enum symbolfix_type type,
-					    struct fexpr_list *diagnosis);
+					    struct fexpr_list *diagnosis,
+					    struct cfdata *data);
 static struct sfl_list *minimise_diagnoses(PicoSAT *pico,
 					   struct fexl_list *diagnoses,
 					   struct cfdata *data);
 
 static tristate calculate_new_tri_val(struct fexpr *e,
-				      struct fexpr_list *diagnosis);
+				      struct fexpr_list *diagnosis,
+				      struct cfdata *data);
 static const char *calculate_new_string_value(struct fexpr *e,
 					      struct fexpr_list *diagnosis);
 static bool fexpr_list_has_length_1(struct fexpr_list *list);
@@ -104,7 +115,10 @@ struct sfl_list *fixgen_run(PicoSAT *pico, struct cfdata *data,
 
 	/* generate the diagnoses */
 	start = clock();
-	diagnoses = generate_diagnoses(pico, data, status);
+	if (getenv("KCONFIG_CF_MAXSAT"))
+		diagnoses = generate_min_diagnoses(pico, data, status);
+	else
+		diagnoses = generate_diagnoses(pico, data, status);
 	end = clock();
 
 	time = ((double) (end - start)) / CLOCKS_PER_SEC;
@@ -179,7 +193,7 @@ static struct fexl_list *generate_diagnoses(PicoSAT *pico, struct cfdata *data,
 		set_assumptions(pico, c, data);
 		CF_LIST_FREE(c, fexpr);
 
-		res = picosat_sat(pico, -1);
+		res = portfolio_sat(pico, data);
 
 		if (res == PICOSAT_SATISFIABLE) {
 			if (PRINT_DIAGNOSIS_FOUND && CFDEBUG)
@@ -307,6 +321,337 @@ DIAGNOSES_FOUND:
 	return R;
 }
 
+/*
+ * weight for changing the value of a symbol, changing symbols set by the user
+ * is more expensive
+ */
+static unsigned int sym_fix_weight(struct symbol *sym)
+{
+	if (sym->flags & SYMBOL_DEF_USER)
+		return FIX_WEIGHT_USER;
+
+	return FIX_WEIGHT_DEFAULT;
+}
+
+/* state of the search for a minimum-weight hitting set */
+struct hs_search {
+	struct fexl_list *cores;
+	struct fexl_list *blocked; // diagnoses found so far
+	bool *chosen; // indexed by satval
+	unsigned int *sym_chosen; // chosen fexprs per symbol, indexed by id
+	unsigned int *sym_mark; // see hs_next_core(), indexed by symbol id
+	unsigned int mark;
+	struct fexpr **set;
+	size_t set_nr;
+	struct fexpr **best;
+	size_t best_nr;
+	unsigned int best_weight;
+	clock_t start;
+	unsigned int nodes;
+	enum fixgen_exit_status status;
+};
+
+/*
+ * check whether the current set contains a diagnosis found before
+ */
+static bool hs_is_blocked(struct hs_search *hs)
+{
+	struct fexl_node *lnode;
+
+	CF_LIST_FOR_EACH(lnode, hs->blocked, fexl) {
+		struct fexpr_node *node;
+		bool contained = true;
+
+		CF_LIST_FOR_EACH(node, lnode->elem, fexpr) {
+			if (!hs->chosen[node->elem->satval]) {
+				contained = false;
+				break;
+			}
+		}
+		if (contained)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * return the first core not hit yet, NULL if all are hit
+ * @bound: returns a lower bound for the weight still needed to hit all cores,
+ *	   the sum of the cheapest fexpr of each core that shares no symbol
+ *	   with the cores counted before
+ */
+static struct fexpr_list *hs_next_core(struct hs_search *hs,
+				       unsigned int *bound)
+{
+	struct fexpr_list *first = NULL;
+	struct fexl_node *lnode;
+	struct fexpr_node *node;
+
+	*bound = 0;
+	hs->mark++;
+
+	CF_LIST_FOR_EACH(lnode, hs->cores, fexl) {
+		unsigned int min = UINT_MAX;
+		bool hit = false, disjoint = true;
+
+		CF_LIST_FOR_EACH(node, lnode->elem, fexpr) {
+			struct symbol *sym = node->elem->sym;
+			unsigned int w;
+
+			if (hs->chosen[node->elem->satval]) {
+				hit = true;
+				break;
+			}
+			if (hs->sym_mark[sym->id] == hs->mark)
+				disjoint = false;
+			w = hs->sym_chosen[sym->id] ? 0 : sym_fix_weight(sym);
+			if (w < min)
+				min = w;
+		}
+		if (hit)
+			continue;
+		if (!first)
+			first = lnode->elem;
+		if (!disjoint)
+			continue;
+
+		CF_LIST_FOR_EACH(node, lnode->elem, fexpr)
+			hs->sym_mark[node->elem->sym->id] = hs->mark;
+		*bound += min;
+	}
+
+	return first;
+}
+
+/* check the time limit and whether the user cancelled the search */
+static bool hs_stopped(struct hs_search *hs)
+{
+	double time_t;
+
+	if (hs->status != CFGEN_STATUS_NORMAL)
+		return true;
+
+	if (stop_fixgen) {
+		stop_fixgen = false;
+		hs->status = CFGEN_STATUS_CANCELED;
+		return true;
+	}
+
+	/* clock() is a system call, only look at it now and then */
+	if (++hs->nodes % 1024)
+		return false;
+	time_t = ((double) (clock() - hs->start)) / CLOCKS_PER_SEC;
+	if (time_t > (double) MAX_SECONDS) {
+		hs->status = CFGEN_STATUS_TIMEOUT;
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * branch and bound over the elements of the first core not hit yet, the
+ * weight of a symbol is added when the first of its fexprs is chosen
+ */
+static void hs_branch(struct hs_search *hs, unsigned int weight)
+{
+	struct fexpr_list *core;
+	struct fexpr_node *node;
+	unsigned int bound;
+
+	if (weight >= hs->best_weight || hs_stopped(hs) || hs_is_blocked(hs))
+		return;
+
+	core = hs_next_core(hs, &bound);
+
+	/* all cores are hit */
+	if (!core) {
+		memcpy(hs->best, hs->set, hs->set_nr * sizeof(*hs->set));
+		hs->best_nr = hs->set_nr;
+		hs->best_weight = weight;
+		return;
+	}
+
+	if (weight + bound >= hs->best_weight)
+		return;
+
+	CF_LIST_FOR_EACH(node, core, fexpr) {
+		struct fexpr *e = node->elem;
+		unsigned int id = e->sym->id;
+
+		hs->chosen[e->satval] = true;
+		hs->set[hs->set_nr++] = e;
+		hs_branch(hs, weight +
+			  (hs->sym_chosen[id]++ ? 0 : sym_fix_weight(e->sym)));
+		hs->sym_chosen[id]--;
+		hs->set_nr--;
+		hs->chosen[e->satval] = false;
+
+		if (hs->status != CFGEN_STATUS_NORMAL)
+			return;
+	}
+}
+
+/*
+ * calculate a minimum-weight hitting set of the cores that does not contain
+ * any of the blocked sets, NULL if there is none or the search was stopped
+ * @start: when the generation of diagnoses started, for the time limit
+ * @status: returns the exit status
+ */
+static struct fexpr_list *min_hitting_set(struct fexl_list *cores,
+					  struct fexl_list *blocked,
+					  struct cfdata *data, clock_t start,
+					  enum fixgen_exit_status *status,
+					  unsigned int *weight)
+{
+	size_t nr_cores = list_count_nodes(&cores->list);
+	struct fexpr_list *ret = NULL;
+	struct hs_search hs = {
+		.cores = cores,
+		.blocked = blocked,
+		.best_weight = UINT_MAX,
+		.start = start,
+		.status = CFGEN_STATUS_NORMAL,
+	};
+
+	hs.chosen = xcalloc(data->sat_variable_nr, sizeof(*hs.chosen));
+	hs.sym_chosen = xcalloc(sym_array_nr, sizeof(*hs.sym_chosen));
+	hs.sym_mark = xcalloc(sym_array_nr, sizeof(*hs.sym_mark));
+	hs.set = xcalloc(nr_cores + 1, sizeof(*hs.set));
+	hs.best = xcalloc(nr_cores + 1, sizeof(*hs.best));
+
+	hs_branch(&hs, 0);
+
+	*status = hs.status;
+	if (hs.status == CFGEN_STATUS_NORMAL &&
+	    hs.best_weight != UINT_MAX) {
+		ret = CF_LIST_INIT(fexpr);
+		for (size_t i = 0; i < hs.best_nr; i++)
+			CF_PUSH_BACK(ret, hs.best[i], fexpr);
+		*weight = hs.best_weight;
+	}
+
+	free(hs.chosen);
+	free(hs.sym_chosen);
+	free(hs.sym_mark);
+	free(hs.set);
+	free(hs.best);
+
+	return ret;
+}
+
+/*
+ * generate minimum-weight diagnoses with an implicit hitting set approach:
+ * a minimum-weight hitting set of all cores found so far is a diagnosis if the
+ * remaining soft constraints are satisfiable, otherwise the solver returns a
+ * new core that is disjoint from it
+ * @status: returns the exit status
+ */
+static struct fexl_list *generate_min_diagnoses(PicoSAT *pico,
+						struct cfdata *data,
+						enum fixgen_exit_status *status)
+{
+	CF_DEF_LIST(C, fexpr);
+	CF_DEF_LIST(cores, fexl);
+	CF_DEF_LIST(R, fexl);
+	struct fexl_node *node;
+	size_t num_diagnoses = 0;
+	clock_t start_t, end_t;
+	double time_t;
+
+	/* create constraint set C */
+	add_fexpr_to_constraint_set(C, data);
+
+	start_t = clock();
+
+	*status = CFGEN_STATUS_NORMAL;
+	while (num_diagnoses < MAX_DIAGNOSES) {
+		struct fexpr_list *H, *c, *X;
+		unsigned int weight;
+		int res;
+
+		H = min_hitting_set(cores, R, data, start_t, status,
+				    &weight);
+		if (!H)
+			break;
+
+		/* set assumptions for C\H */
+		nr_of_assumptions = 0;
+		nr_of_assumptions_true = 0;
+		c = get_difference(C, H);
+		set_assumptions(pico, c, data);
+		CF_LIST_FREE(c, fexpr);
+
+		res = portfolio_sat(pico, data);
+
+		if (res == PICOSAT_SATISFIABLE) {
+			/* nothing needs to be changed, as in the HS-tree */
+			if (list_empty(&H->list)) {
+				CF_LIST_FREE(H, fexpr);
+				break;
+			}
+
+			if (PRINT_DIAGNOSIS_FOUND && CFDEBUG) {
+				printd("Weight %u: ", weight);
+				fexpr_list_print("DIAGNOSIS FOUND", H);
+			}
+
+			CF_PUSH_BACK(R, H, fexl);
+			++num_diagnoses;
+			continue;
+		}
+
+		CF_LIST_FREE(H, fexpr);
+
+		if (res == PICOSAT_UNKNOWN)
+			printd("UNKNOWN\n");
+
+		/* check elapsed time */
+		end_t = clock();
+		time_t = ((double) (end_t - start_t)) / CLOCKS_PER_SEC;
+		if (time_t > (double) MAX_SECONDS) {
+			*status = CFGEN_STATUS_TIMEOUT;
+			break;
+		}
+
+		/* abort and return results if cancelled by user */
+		if (stop_fixgen) {
+			stop_fixgen = false;
+			*status = CFGEN_STATUS_CANCELED;
+			break;
+		}
+
+		if (res != PICOSAT_UNSATISFIABLE)
+			break;
+
+		/* get unsat core from SAT solver */
+		X = get_unsat_core_soft(pico, data);
+
+		/* the conflict-symbols alone are unsatisfiable */
+		if (list_empty(&X->list)) {
+			CF_LIST_FREE(X, fexpr);
+			break;
+		}
+
+		/* minimise the unsat core */
+		if (MINIMISE_UNSAT_CORE)
+			minimise_unsat_core(pico, X, data);
+
+		if (PRINT_UNSAT_CORE)
+			print_unsat_core(X);
+
+		CF_PUSH_BACK(cores, X, fexl);
+	}
+
+	CF_LIST_FREE(C, fexpr);
+	CF_LIST_FOR_EACH(node, cores, fexl)
+		CF_LIST_FREE(node->elem, fexpr);
+	CF_LIST_FREE(cores, fexl);
+
+	return R;
+}
+
 /*
  * add the fexpr to the constraint set C
  */
@@ -316,6 +661,8 @@ static void add_fexpr_to_constraint_set(struct fexpr_list *C,
 	struct symbol *sym;
 
 	for_all_symbols(sym) {
+		struct sym_cfdata *cf = sym_cf(data, sym);
+
 		/* must be a proper symbol */
 		if (sym->type == S_UNKNOWN)
 			continue;
@@ -323,7 +670,7 @@ static void add_fexpr_to_constraint_set(struct fexpr_list *C,
 		/*
 		 * don't need the conflict symbols they are handled separately
 		 */
-		if (sym_is_sdv(data->sdv_symbols, sym))
+		if (sym_is_sdv(data, sym))
 			continue;
 
 		/* must have a prompt and a name */
@@ -331,15 +678,15 @@ static void add_fexpr_to_constraint_set(struct fexpr_list *C,
 			continue;
 
 		if (sym->type == S_BOOLEAN)
-			CF_PUSH_BACK(C, sym->fexpr_y, fexpr);
+			CF_PUSH_BACK(C, cf->fexpr_y, fexpr);
 		else if (sym->type == S_TRISTATE) {
-			CF_PUSH_BACK(C, sym->fexpr_y, fexpr);
-			CF_PUSH_BACK(C, sym->fexpr_both, fexpr);
+			CF_PUSH_BACK(C, cf->fexpr_y, fexpr);
+			CF_PUSH_BACK(C, cf->fexpr_both, fexpr);
 		} else if (sym->type == S_INT || sym->type == S_HEX ||
 			   sym->type == S_STRING) {
 			struct fexpr_node *node;
 
-			CF_LIST_FOR_EACH(node, sym->nb_vals, fexpr)
+			CF_LIST_FOR_EACH(node, cf->nb_vals, fexpr)
 				CF_PUSH_BACK(C, node->elem, fexpr);
 		} else {
 			perror("Error adding variables to constraint set C.");
@@ -347,72 +694,62 @@ static void add_fexpr_to_constraint_set(struct fexpr_list *C,
 	}
 }
 
-/*
- * check whether the fexpr symbolises the no-value-set fexpr for a non-boolean
- * symbol
- */
-static bool fexpr_is_novalue(struct fexpr *e)
-{
-	if (!sym_is_nonboolean(e->sym))
-		return false;
-
-	return e ==
-	       list_first_entry(&e->sym->nb_vals->list, struct fexpr_node, node)
-		       ->elem;
-}
-
-static void set_assumptions_sdv(PicoSAT *pico, struct sdv_list *arr)
+static void set_assumptions_sdv(PicoSAT *pico, struct sdv_list *arr,
+				struct cfdata *data)
 {
 	struct symbol_dvalue *sdv;
 	struct sdv_node *node;
 	struct symbol *sym;
 
 	CF_LIST_FOR_EACH(node, arr, sdv) {
+		struct fexpr *fexpr_y, *fexpr_both;
 		int lit_y;
 
 		sdv = node->elem;
 		sym = sdv->sym;
+		fexpr_y = sym_cf(data, sym)->fexpr_y;
+		fexpr_both = sym_cf(data, sym)->fexpr_both;
 
-		lit_y = sym->fexpr_y->satval;
+		lit_y = fexpr_y->satval;
 
 		if (sym->type == S_BOOLEAN) {
 			switch (sdv->tri) {
 			case yes:
-				picosat_assume(pico, lit_y);
-				sym->fexpr_y->assumption = true;
+				portfolio_assume(pico, lit_y);
+				fexpr_y->assumption = true;
 				nr_of_assumptions_true++;
 				break;
 			case no:
-				picosat_assume(pico, -lit_y);
-				sym->fexpr_y->assumption = false;
+				portfolio_assume(pico, -lit_y);
+				fexpr_y->assumption = false;
 				break;
 			case mod:
 				perror("Should not happen.\n");
 			}
 			nr_of_assumptions++;
 		} else if (sym->type == S_TRISTATE) {
-			int lit_both = sym->fexpr_both->satval;
+			int lit_both = fexpr_both->satval;
 
 			switch (sdv->tri) {
 			case yes:
-				picosat_assume(pico, lit_y);
-				sym->fexpr_y->assumption = true;
-				picosat_assume(pico, lit_both);
-				sym->fexpr_both->assumption = true;
+				portfolio_assume(pico, lit_y);
+				fexpr_y->assumption = true;
+				portfolio_assume(pico, lit_both);
+				fexpr_both->assumption = true;
 				nr_of_assumptions_true++;
 				break;
 			case mod:
-				picosat_assume(pico, -lit_y);
-				sym->fexpr_y->assumption = false;
-				picosat_assume(pico, lit_both);
-				sym->fexpr_both->assumption = true;
+				portfolio_assume(pico, -lit_y);
+				fexpr_y->assumption = false;
+				portfolio_assume(pico, lit_both);
+				fexpr_both->assumption = true;
 				nr_of_assumptions_true++;
 				break;
 			case no:
-				picosat_assume(pico, -lit_y);
-				sym->fexpr_y->assumption = false;
-				picosat_assume(pico, -lit_both);
-				sym->fexpr_y->assumption = false;
+				portfolio_assume(pico, -lit_y);
+				fexpr_y->assumption = false;
+				portfolio_assume(pico, -lit_both);
+				fexpr_y->assumption = false;
 			}
 			nr_of_assumptions += 2;
 		}
@@ -428,101 +765,28 @@ static void set_assumptions(PicoSAT *pico, struct fexpr_list *c,
 	struct fexpr_node *node;
 
 	CF_LIST_FOR_EACH(node, c, fexpr)
-		fexpr_add_assumption(pico, node->elem, node->elem->satval);
+		fexpr_add_assumption(pico, node->elem, data);
 
 	/* set assumptions for the conflict-symbols */
-	set_assumptions_sdv(pico, data->sdv_symbols);
+	set_assumptions_sdv(pico, data->sdv_symbols, data);
 }
 
 /*
  * set the assumtption for a fexpr for the next run of Picosat
  */
-static void fexpr_add_assumption(PicoSAT *pico, struct fexpr *e, int satval)
+static void fexpr_add_assumption(PicoSAT *pico, struct fexpr *e,
+				 struct cfdata *data)
 {
-	struct symbol *sym = e->sym;
-
-	if (sym->type == S_BOOLEAN) {
-		int tri_val = sym_get_tristate_value(sym);
-
-		if (tri_val == yes) {
-			picosat_assume(pico, satval);
-			e->assumption = true;
-			nr_of_assumptions_true++;
-		} else {
-			picosat_assume(pico, -satval);
-			e->assumption = false;
-		}
-		nr_of_assumptions++;
-	}
-
-	if (sym->type == S_TRISTATE) {
-		int tri_val = sym_get_tristate_value(sym);
-
-		if (e->tri == yes) {
-			/* fexpr_y */
-			if (tri_val == yes) {
-				picosat_assume(pico, satval);
-				e->assumption = true;
-				nr_of_assumptions_true++;
-			} else {
-				picosat_assume(pico, -satval);
-				e->assumption = false;
-			}
-		} else if (e->tri == mod) {
-			/* fexpr_both */
-			if (tri_val == mod || tri_val == yes) {
-				picosat_assume(pico, satval);
-				e->assumption = true;
-				nr_of_assumptions_true++;
-			} else {
-				picosat_assume(pico, -satval);
-				e->assumption = false;
-			}
-		}
-		nr_of_assumptions++;
-	}
-
-	if (sym->type == S_INT || sym->type == S_HEX || sym->type == S_STRING) {
-
-		char *string_val = (char *) sym_get_string_value(sym);
+	int lit = data->assumptions[e->satval];
 
-		if (sym->type == S_STRING && !strcmp(string_val, ""))
-			return;
+	/* e.g. a string-symbol with value "" */
+	if (!lit)
+		return;
 
-		/* check, if e symbolises the no-value-set fexpr */
-		if (fexpr_is_novalue(e)) {
-			if (!sym_nonbool_has_value_set(sym)) {
-				picosat_assume(pico, satval);
-				e->assumption = true;
-				nr_of_assumptions_true++;
-			} else {
-				picosat_assume(pico, -satval);
-				e->assumption = false;
-			}
-		}
-		/* check whena string-symbol has value "" */
-		else if (sym->type == S_STRING && !strcmp(string_val, "")) {
-			if (sym_nonbool_has_value_set(sym)) {
-				picosat_assume(pico, satval);
-				e->assumption = true;
-				nr_of_assumptions_true++;
-			} else {
-				picosat_assume(pico, -satval);
-				e->assumption = false;
-			}
-		} else {
-			if (!strcmp(str_get(&e->nb_val), string_val) &&
-					sym_nonbool_has_value_set(sym)) {
-				picosat_assume(pico, satval);
-				e->assumption = true;
-				nr_of_assumptions_true++;
-			} else {
-				picosat_assume(pico, -satval);
-				e->assumption = false;
-			}
-		}
-		nr_of_assumptions++;
-	}
+	portfolio_assume(pico, lit);
+	if (lit > 0)
+		nr_of_assumptions_true++;
+	nr_of_assumptions++;
 }
 
 /*
@@ -535,14 +799,14 @@ static struct fexpr_list *get_unsat_core_soft(PicoSAT *pico,
 	struct fexpr *e;
 
 	int lit;
-	const int *i = picosat_failed_assumptions(pico);
+	const int *i = portfolio_failed_assumptions(pico);
 
 	lit = abs(*i++);
 
 	while (lit != 0) {
 		e = data->satmap[lit];
 
-		if (!sym_is_sdv(data->sdv_symbols, e->sym))
+		if (!sym_is_sdv(data, e->sym))
 			CF_PUSH_BACK(ret, e, fexpr);
 
 		lit = abs(*i++);
@@ -578,7 +842,7 @@ static void minimise_unsat_core(PicoSAT *pico, struct fexpr_list *C,
 		/* invoke PicoSAT */
 		set_assumptions(pico, t, data);
 
-		res = picosat_sat(pico, -1);
+		res = portfolio_sat(pico, data);
 
 		if (res == PICOSAT_UNSATISFIABLE) {
 			list_del(&node->node);
@@ -864,7 +1128,7 @@ static struct sfix_list *convert_diagnosis(struct fexpr_list *diagnosis,
 			type = SF_NONBOOLEAN;
 		else
 			type = SF_DISALLOWED;
-		fix = symbol_fix_create(e, type, diagnosis);
+		fix = symbol_fix_create(e, type, diagnosis, data);
 
 		CF_PUSH_BACK(diagnosis_symbol, fix, sfix);
 	}
@@ -897,7 +1161,8 @@ static struct sfl_list *convert_diagnoses(struct fexl_list *diag_arr,
  */
 static struct symbol_fix *symbol_fix_create(struct fexpr *e,
 					    enum symbolfix_type type,
-					    struct fexpr_list *diagnosis)
+					    struct fexpr_list *diagnosis,
+					    struct cfdata *data)
 {
 	struct symbol_fix *fix = malloc(sizeof(struct symbol_fix));
 
@@ -906,7 +1171,7 @@ static struct symbol_fix *symbol_fix_create(struct fexpr *e,
 
 	switch (type) {
 	case SF_BOOLEAN:
-		fix->tri = calculate_new_tri_val(e, diagnosis);
+		fix->tri = calculate_new_tri_val(e, diagnosis, data);
 		break;
 	case SF_NONBOOLEAN:
 		fix->nb_val = str_new();
@@ -936,7 +1201,7 @@ static struct sfl_list *minimise_diagnoses(PicoSAT *pico,
 	struct sfix_list *diagnosis_symbol;
 	CF_DEF_LIST(diagnoses_symbol, sfl);
 	struct fexpr *e;
-	int satval, deref = 0;
+	int satval, sel_y, deref = 0;
 	struct symbol_fix *fix;
 	struct fexl_node *flnode;
 	CF_DEF_LIST(C, fexpr);
@@ -970,10 +1235,10 @@ static struct sfl_list *minimise_diagnoses(PicoSAT *pico,
 		CF_LIST_FOR_EACH(fnode, d, fexpr) {
 			e = fnode->elem;
 			satval = e->assumption ? -(e->satval) : e->satval;
-			picosat_assume(pico, satval);
+			portfolio_assume(pico, satval);
 		}
 
-		res = picosat_sat(pico, -1);
+		res = portfolio_sat(pico, data);
 		if (res != PICOSAT_SATISFIABLE)
 			perror("Diagnosis not satisfiable (minimise).");
 
@@ -985,25 +1250,24 @@ static struct sfl_list *minimise_diagnoses(PicoSAT *pico,
 			fix = snode->elem;
 
 			/* symbol is never selected, continue */
-			if (!fix->sym->fexpr_sel_y)
+			if (!sym_cf(data, fix->sym)->fexpr_sel_y)
 				continue;
+			sel_y = sym_cf(data, fix->sym)->fexpr_sel_y->satval;
 
 			/* check, whether the symbol was selected anyway */
 			if (fix->sym->type == S_BOOLEAN && fix->tri == yes)
-				deref = picosat_deref(
-					pico, fix->sym->fexpr_sel_y->satval);
+				deref = portfolio_deref(pico, sel_y);
 			else if (fix->sym->type == S_TRISTATE &&
 				 fix->tri == yes)
-				deref = picosat_deref(
-					pico, fix->sym->fexpr_sel_y->satval);
+				deref = portfolio_deref(pico, sel_y);
 			else if (fix->sym->type == S_TRISTATE &&
 				 fix->tri == mod) {
 				bool is_y, is_both;
 
-				is_y = picosat_deref(
-					pico, fix->sym->fexpr_sel_y->satval);
-				is_both = picosat_deref(
-					pico, fix->sym->fexpr_sel_both->satval);
+				is_y = portfolio_deref(pico, sel_y);
+				is_both = portfolio_deref(
+					pico,
+					sym_cf(data, fix->sym)->fexpr_sel_both->satval);
 				deref = is_both && !is_y ? 1 : 0;
 			}
 
@@ -1051,7 +1315,8 @@ struct sfix_list *ask_user_choose_fix(struct sfl_list *diag)
  * calculate the new value for a boolean symbol given a diagnosis and an fexpr
  */
 static tristate calculate_new_tri_val(struct fexpr *e,
-				      struct fexpr_list *diagnosis)
+				      struct fexpr_list *diagnosis,
+				      struct cfdata *data)
 {
 	assert(sym_is_boolean(e->sym));
 
@@ -1078,13 +1343,14 @@ static tristate calculate_new_tri_val(struct fexpr *e,
 		 * if diagnosis contains fexpr_both, new value
 		 * is no, else mod
 		 */
-		return diagnosis_contains_fexpr(diagnosis, e->sym->fexpr_both) ?
+		return diagnosis_contains_fexpr(
+			       diagnosis, sym_cf(data, e->sym)->fexpr_both) ?
 			       no :
 			       mod;
 	}
 	/* fexpr_both */
 	if (e->tri == mod) {
-		bool assumed_yes = e->sym->fexpr_y->assumption;
+		bool assumed_yes = sym_cf(data, e->sym)->fexpr_y->assumption;
 		bool contains_fexpr_y;
 
 		if (e->assumption == true)
@@ -1093,8 +1359,8 @@ static tristate calculate_new_tri_val(struct fexpr *e,
 			 */
 			return no;
 
-		contains_fexpr_y =
-			diagnosis_contains_fexpr(diagnosis, e->sym->fexpr_y);
+		contains_fexpr_y = diagnosis_contains_fexpr(
+			diagnosis, sym_cf(data, e->sym)->fexpr_y);
 		if (assumed_yes) {
 			/*
 			 * If diagnosis contains fexpr_y, fexpr_y must be false
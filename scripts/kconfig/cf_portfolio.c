@@ -0,0 +1,225 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Portfolio solving for the SAT calls of the fix generation.
+ *
+ * Each call is first given to the main solver with a small decision limit.
+ * Only if that does not suffice, the call is raced between the main solver and
+ * further solver instances that use different seeds and default phases. The
+ * first answer wins and the remaining instances are interrupted.
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <array_size.h>
+#include <xalloc.h>
+
+#include "cf_defs.h"
+#include "cf_portfolio.h"
+#include "cf_utils.h"
+#include "picosat_functions.h"
+
+/* number of solver instances, can be overridden by KCONFIG_CF_PORTFOLIO */
+#define PORTFOLIO_SIZE 4
+/* decisions the main solver gets before a call is considered hard */
+#define PORTFOLIO_DECISION_LIMIT 2000
+#define ASSUMPTIONS_INIT_SIZE 256
+
+struct portfolio_worker {
+	PicoSAT *pico;
+	pthread_t thread;
+	/* number of stored clauses already added to pico */
+	size_t nr_clauses;
+	int res;
+};
+
+/* default phases of the workers: false, true, random */
+static const int worker_phases[] = { 0, 1, 3 };
+
+static struct portfolio_worker *workers;
+static int nr_workers = -1;
+
+/* assumptions for the next call, to be replayed on the workers */
+static int *assumptions;
+static size_t assumptions_nr, assumptions_size;
+
+static atomic_bool race_done;
+static PicoSAT *winner;
+static int winner_res;
+
+/*
+ * create the worker instances, if the portfolio is enabled
+ */
+static void portfolio_init(void)
+{
+	const char *env = getenv("KCONFIG_CF_PORTFOLIO");
+	int size = env ? atoi(env) : PORTFOLIO_SIZE;
+
+	if (size < 1 || !picosat_has_portfolio_functions())
+		size = 1;
+
+	nr_workers = size - 1;
+	if (!nr_workers)
+		return;
+
+	workers = xcalloc(nr_workers, sizeof(*workers));
+	for (int i = 0; i < nr_workers; i++) {
+		struct portfolio_worker *w = &workers[i];
+
+		w->pico = picosat_init();
+		picosat_set_seed(w->pico, i + 1);
+		picosat_set_global_default_phase(
+			w->pico, worker_phases[i % ARRAY_SIZE(worker_phases)]);
+	}
+
+	printd("Using a portfolio of %d SAT solvers.\n", size);
+}
+
+static int race_interrupted(void *state)
+{
+	return atomic_load(&race_done) || stop_fixgen;
+}
+
+/*
+ * the first solver instance to call this wins the race
+ */
+static void finish_race(PicoSAT *pico, int res)
+{
+	if (atomic_exchange(&race_done, true))
+		return;
+
+	winner = pico;
+	winner_res = res;
+}
+
+/*
+ * add the clauses that the worker is missing
+ */
+static void worker_sync(struct portfolio_worker *w, struct cfdata *data)
+{
+	picosat_adjust(w->pico, data->sat_variable_nr - 1);
+	cnf_add_clauses(w->pico, data, w->nr_clauses);
+	w->nr_clauses = data->cnf.nr_clauses;
+}
+
+static void *worker_run(void *arg)
+{
+	struct portfolio_worker *w = arg;
+
+	for (size_t i = 0; i < assumptions_nr; i++)
+		picosat_assume(w->pico, assumptions[i]);
+
+	w->res = picosat_sat(w->pico, -1);
+	if (w->res != PICOSAT_UNKNOWN)
+		finish_race(w->pico, w->res);
+
+	return NULL;
+}
+
+/*
+ * race the main solver against the workers
+ */
+static int portfolio_race(PicoSAT *pico, struct cfdata *data)
+{
+	int started, res;
+
+	atomic_store(&race_done, false);
+	winner = NULL;
+	picosat_set_interrupt(pico, NULL, race_interrupted);
+
+	for (started = 0; started < nr_workers; started++) {
+		struct portfolio_worker *w = &workers[started];
+
+		worker_sync(w, data);
+		picosat_set_interrupt(w->pico, NULL, race_interrupted);
+		if (pthread_create(&w->thread, NULL, worker_run, w)) {
+			printd("Could not start portfolio worker %d.\n",
+			       started);
+			break;
+		}
+	}
+
+	/* the main solver takes part in the race from this thread */
+	for (size_t i = 0; i < assumptions_nr; i++)
+		picosat_assume(pico, assumptions[i]);
+
+	res = picosat_sat(pico, -1);
+	if (res != PICOSAT_UNKNOWN)
+		finish_race(pico, res);
+
+	for (int i = 0; i < started; i++)
+		pthread_join(workers[i].thread, NULL);
+
+	atomic_store(&race_done, false);
+
+	/* every solver was interrupted by the user */
+	if (!winner) {
+		winner = pico;
+		return PICOSAT_UNKNOWN;
+	}
+
+	return winner_res;
+}
+
+/*
+ * add an assumption for the next call to portfolio_sat()
+ */
+void portfolio_assume(PicoSAT *pico, int lit)
+{
+	if (assumptions_nr == assumptions_size) {
+		assumptions_size = assumptions_size ? assumptions_size * 2 :
+						      ASSUMPTIONS_INIT_SIZE;
+		assumptions = xrealloc(assumptions,
+				       assumptions_size * sizeof(*assumptions));
+	}
+	assumptions[assumptions_nr++] = lit;
+
+	picosat_assume(pico, lit);
+}
+
+/*
+ * solve with the assumptions added by portfolio_assume(), racing several
+ * solver instances if the call turns out to be hard
+ */
+int portfolio_sat(PicoSAT *pico, struct cfdata *data)
+{
+	int res;
+
+	if (nr_workers < 0)
+		portfolio_init();
+
+	winner = pico;
+
+	if (!nr_workers) {
+		res = picosat_sat(pico, -1);
+	} else {
+		res = picosat_sat(pico, PORTFOLIO_DECISION_LIMIT);
+		if (res == PICOSAT_UNKNOWN && !stop_fixgen)
+			res = portfolio_race(pico, data);
+	}
+
+	assumptions_nr = 0;
+	return res;
+}
+
+/*
+ * return the failed assumptions of the solver instance that answered the last
+ * call to portfolio_sat()
+ */
+const int *portfolio_failed_assumptions(PicoSAT *pico)
+{
+	return picosat_failed_assumptions(winner ? winner : pico);
+}
+
+/*
+ * return the value of a literal in the model found by the last call to
+ * portfolio_sat()
+ */
+int portfolio_deref(PicoSAT *pico, int lit)
+{
+	return picosat_deref(winner ? winner : pico, lit);
+}
@@ -0,0 +1,21 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+#ifndef CF_PORTFOLIO_H
+#define CF_PORTFOLIO_H
+
+#include "picosat_functions.h"
+#include "cf_defs.h"
+
+/* add an assumption for the next call to portfolio_sat() */
+void portfolio_assume(PicoSAT *pico, int lit);
+
+/* solve, racing several solver instances if the call turns out to be hard */
+int portfolio_sat(PicoSAT *pico, struct cfdata *data);
+
+/* failed assumptions of the solver instance that answered the last call */
+const int *portfolio_failed_assumptions(PicoSAT *pico);
+
+/* value of a literal in the model found by the last call */
+int portfolio_deref(PicoSAT *pico, int lit);
+
+#endif
@@ -25,9 +25,17 @@
 #include "list.h"
 
 #define SATMAP_INIT_SIZE 2
+#define CNF_LITS_INIT_SIZE 4096
+#define CNF_CLAUSES_INIT_SIZE 1024
+#define BITS_PER_LONG (sizeof(unsigned long) * 8)
+#define BITS_TO_LONGS(n) (((n) + BITS_PER_LONG - 1) / BITS_PER_LONG)
 
 static PicoSAT *pico;
+static struct cfdata *cnf_data;
+static struct symbol *cnf_sym;
 
+static void sat_add_lit(PicoSAT *p, int lit);
+static bool sdv_bit_test(struct cfdata *data, int satval);
 static void unfold_cnf_clause(struct pexpr *e);
 static void build_cnf_tseytin(struct pexpr *e, struct cfdata *data);
 
@@ -56,6 +64,10 @@ void init_data(struct cfdata *data)
 	data->satmap = xcalloc(SATMAP_INIT_SIZE, sizeof(typeof(*data->satmap)));
 	data->satmap_size = SATMAP_INIT_SIZE;
 
+	/* ConfigFix state of all symbols, plus symbol_yes/mod/no */
+	data->syms_nr = sym_array_nr + 3;
+	data->syms = xcalloc(data->syms_nr, sizeof(*data->syms));
+
 	printd("done.\n");
 }
 
@@ -69,7 +81,7 @@ void create_sat_variables(struct cfdata *data)
 	printd("Creating SAT-variables...");
 
 	for_all_symbols(sym) {
-		sym->constraints = CF_LIST_INIT(pexpr);
+		sym_cf(data, sym)->constraints = CF_LIST_INIT(pexpr);
 		sym_create_fexpr(sym, data);
 	}
 
@@ -94,14 +106,14 @@ void create_constants(struct cfdata *data)
 	fexpr_add_to_satmap(data->constants->const_true, data);
 
 	/* add fexpr of constants to tristate constants */
-	symbol_yes.fexpr_y = data->constants->const_true;
-	symbol_yes.fexpr_both = data->constants->const_true;
+	sym_cf(data, &symbol_yes)->fexpr_y = data->constants->const_true;
+	sym_cf(data, &symbol_yes)->fexpr_both = data->constants->const_true;
 
-	symbol_mod.fexpr_y = data->constants->const_false;
-	symbol_mod.fexpr_both = data->constants->const_true;
+	sym_cf(data, &symbol_mod)->fexpr_y = data->constants->const_false;
+	sym_cf(data, &symbol_mod)->fexpr_both = data->constants->const_true;
 
-	symbol_no.fexpr_y = data->constants->const_false;
-	symbol_no.fexpr_both = data->constants->const_false;
+	sym_cf(data, &symbol_no)->fexpr_y = data->constants->const_false;
+	sym_cf(data, &symbol_no)->fexpr_both = data->constants->const_false;
 
 	/* create symbols yes/mod/no as fexpr */
 	data->constants->symbol_yes_fexpr = fexpr_create(0, FE_SYMBOL, "y");
@@ -360,15 +372,15 @@ const char *sym_get_name(struct symbol *sym)
 /*
  * check whether symbol is to be changed
  */
-bool sym_is_sdv(struct sdv_list *list, struct symbol *sym)
+bool sym_is_sdv(struct cfdata *data, struct symbol *sym)
 {
-	struct sdv_node *node;
+	struct sym_cfdata *cf = sym_cf(data, sym);
 
-	CF_LIST_FOR_EACH(node, list, sdv)
-		if (sym == node->elem->sym)
-			return true;
+	if (!sym_is_boolean(sym) ||
+	    cf->fexpr_y->satval >= data->assumptions_size)
+		return false;
 
-	return false;
+	return sdv_bit_test(data, cf->fexpr_y->satval);
 }
 
 /*
@@ -390,11 +402,11 @@ void print_sym_name(struct symbol *sym)
 /*
  * print all constraints for a symbol
  */
-void print_sym_constraint(struct symbol *sym)
+void print_sym_constraint(struct symbol *sym, struct cfdata *data)
 {
 	struct pexpr_node *node;
 
-	CF_LIST_FOR_EACH(node, sym->constraints, pexpr)
+	CF_LIST_FOR_EACH(node, sym_cf(data, sym)->constraints, pexpr)
 		pexpr_print("::", node->elem, -1);
 }
 
@@ -479,6 +491,8 @@ void construct_cnf_clauses(PicoSAT *p, struct cfdata *data)
 	struct symbol *sym;
 
 	pico = p;
+	cnf_data = data;
+	cnf_sym = NULL;
 
 	/* adding unit-clauses for constants */
 	sat_add_clause(2, pico, -(data->constants->const_false->satval));
@@ -490,10 +504,11 @@ void construct_cnf_clauses(PicoSAT *p, struct cfdata *data)
 		if (sym->type == S_UNKNOWN)
 			continue;
 
-		CF_LIST_FOR_EACH(node, sym->constraints, pexpr) {
+		cnf_sym = sym;
+		CF_LIST_FOR_EACH(node, sym_cf(data, sym)->constraints, pexpr) {
 			if (pexpr_is_cnf(node->elem)) {
 				unfold_cnf_clause(node->elem);
-				picosat_add(pico, 0);
+				sat_add_lit(pico, 0);
 			} else {
 				build_cnf_tseytin(node->elem, data);
 			}
@@ -502,6 +517,63 @@ void construct_cnf_clauses(PicoSAT *p, struct cfdata *data)
 	}
 }
 
+/*
+ * add a literal to PicoSAT and keep a copy of it in the clause store, so that
+ * further solver instances can be set up without redoing the encoding
+ */
+static void sat_add_lit(PicoSAT *p, int lit)
+{
+	struct cnf_store *cnf;
+
+	picosat_add(p, lit);
+
+	if (p != pico || !cnf_data)
+		return;
+
+	cnf = &cnf_data->cnf;
+
+	if (lit != 0) {
+		if (cnf->lits_nr == cnf->lits_size) {
+			cnf->lits_size = cnf->lits_size ?
+				cnf->lits_size * 2 : CNF_LITS_INIT_SIZE;
+			cnf->lits = xrealloc(cnf->lits,
+					     cnf->lits_size * sizeof(*cnf->lits));
+		}
+		cnf->lits[cnf->lits_nr++] = lit;
+		return;
+	}
+
+	/* the clause is complete */
+	if (cnf->nr_clauses == cnf->clauses_size) {
+		cnf->clauses_size = cnf->clauses_size ?
+			cnf->clauses_size * 2 : CNF_CLAUSES_INIT_SIZE;
+		cnf->clause_start = xrealloc(cnf->clause_start,
+					     (cnf->clauses_size + 1) *
+						     sizeof(*cnf->clause_start));
+		cnf->clause_sym = xrealloc(cnf->clause_sym,
+					   cnf->clauses_size *
+						   sizeof(*cnf->clause_sym));
+		cnf->clause_start[0] = 0;
+	}
+	cnf->clause_sym[cnf->nr_clauses] = cnf_sym;
+	cnf->clause_start[++cnf->nr_clauses] = cnf->lits_nr;
+}
+
+/*
+ * add the stored clauses from index from onwards to another PicoSAT instance
+ */
+void cnf_add_clauses(PicoSAT *p, struct cfdata *data, size_t from)
+{
+	struct cnf_store *cnf = &data->cnf;
+
+	for (size_t c = from; c < cnf->nr_clauses; c++) {
+		for (size_t i = cnf->clause_start[c];
+		     i < cnf->clause_start[c + 1]; i++)
+			picosat_add(p, cnf->lits[i]);
+		picosat_add(p, 0);
+	}
+}
+
 /*
  * helper function to add an expression to a CNF-clause
  */
@@ -509,14 +581,14 @@ static void unfold_cnf_clause(struct pexpr *e)
 {
 	switch (e->type) {
 	case PE_SYMBOL:
-		picosat_add(pico, e->left.fexpr->satval);
+		sat_add_lit(pico, e->left.fexpr->satval);
 		break;
 	case PE_OR:
 		unfold_cnf_clause(e->left.pexpr);
 		unfold_cnf_clause(e->right.pexpr);
 		break;
 	case PE_NOT:
-		picosat_add(pico, -(e->left.pexpr->left.fexpr->satval));
+		sat_add_lit(pico, -(e->left.pexpr->left.fexpr->satval));
 		break;
 	default:
 		perror("Not in CNF, FE_EQUALS.");
@@ -639,21 +711,21 @@ void sat_add_clause(int num, ...)
 {
 	va_list valist;
 	int lit;
-	PicoSAT *pico;
+	PicoSAT *p;
 
 	if (num <= 1)
 		return;
 
 	va_start(valist, num);
 
-	pico = va_arg(valist, PicoSAT *);
+	p = va_arg(valist, PicoSAT *);
 
 	/* access all the arguments assigned to valist */
 	for (int i = 1; i < num; i++) {
 		lit = va_arg(valist, int);
-		picosat_add(pico, lit);
+		sat_add_lit(p, lit);
 	}
-	picosat_add(pico, 0);
+	sat_add_lit(p, 0);
 
 	va_end(valist);
 }
@@ -705,129 +777,163 @@ void picosat_solve(PicoSAT *pico, struct cfdata *data)
 }
 
 /*
- * add assumption for a symbol to the SAT-solver
+ * set the assumption for a fexpr in the assumption vector
  */
-void sym_add_assumption(PicoSAT *pico, struct symbol *sym)
+static void fexpr_set_assumption(struct cfdata *data, struct fexpr *e,
+				 bool val)
 {
+	data->assumptions[e->satval] = val ? e->satval : -(e->satval);
+	e->assumption = val;
+}
+
+/*
+ * update the assumptions for a symbol from its current value
+ */
+void sym_update_assumption(struct cfdata *data, struct symbol *sym)
+{
+	struct sym_cfdata *cf = sym_cf(data, sym);
+
 	if (sym_is_boolean(sym)) {
-		int tri_val = sym_get_tristate_value(sym);
+		tristate tri_val = sym_get_tristate_value(sym);
 
-		sym_add_assumption_tri(pico, sym, tri_val);
+		if (cf->fexpr_y->satval >= data->assumptions_size)
+			return;
+
+		if (sym->type == S_BOOLEAN) {
+			if (tri_val == mod) {
+				perror("Should not happen. Boolean symbol is set to mod.\n");
+				data->assumptions[cf->fexpr_y->satval] = 0;
+				return;
+			}
+			fexpr_set_assumption(data, cf->fexpr_y, tri_val == yes);
+		} else if (sym->type == S_TRISTATE) {
+			fexpr_set_assumption(data, cf->fexpr_y, tri_val == yes);
+			fexpr_set_assumption(data, cf->fexpr_both,
+					     tri_val != no);
+		}
 		return;
 	}
 
 	if (sym_is_nonboolean(sym)) {
-		bool first;
-		struct fexpr *not_set = list_first_entry(&sym->nb_vals->list,
-						   struct fexpr_node, node)
-					  ->elem;
-		struct fexpr_node *node;
-
 		const char *string_val = sym_get_string_value(sym);
+		bool has_value, first = true;
+		struct fexpr_node *node;
 
-		if (sym->type == S_STRING && !strcmp(string_val, ""))
+		if (!cf->nb_vals)
 			return;
 
-		/* symbol does not have a value */
-		if (!sym_nonbool_has_value_set(sym)) {
-			bool first = true;
-
-			/* set value for sym=n */
-			picosat_assume(pico, not_set->satval);
-			not_set->assumption = true;
-
-			CF_LIST_FOR_EACH(node, sym->nb_vals, fexpr) {
-				if (first) {
-					first = false;
-					continue;
-				}
-				picosat_assume(pico, -(node->elem->satval));
-				node->elem->assumption = false;
-			}
-
+		/* no assumptions for a string-symbol with value "" */
+		if (sym->type == S_STRING && !strcmp(string_val, "")) {
+			CF_LIST_FOR_EACH(node, cf->nb_vals, fexpr)
+				if (node->elem->satval < data->assumptions_size)
+					data->assumptions[node->elem->satval] = 0;
 			return;
 		}
 
-		/* symbol does have a value set */
+		has_value = sym_nonbool_has_value_set(sym);
+
+		CF_LIST_FOR_EACH(node, cf->nb_vals, fexpr) {
+			struct fexpr *e = node->elem;
 
-		/* set value for sym=n */
-		picosat_assume(pico, -(not_set->satval));
-		not_set->assumption = false;
+			if (e->satval >= data->assumptions_size)
+				return;
 
-		first = true;
-		/* set value for all other fexpr */
-		CF_LIST_FOR_EACH(node, sym->nb_vals, fexpr) {
+			/* the first fexpr symbolises sym=n */
 			if (first) {
 				first = false;
+				fexpr_set_assumption(data, e, !has_value);
 				continue;
 			}
 
-			if (strcmp(str_get(&node->elem->nb_val), string_val) ==
-			    0) {
-				picosat_assume(pico, node->elem->satval);
-				node->elem->assumption = true;
-			} else {
-				picosat_assume(pico, -(node->elem->satval));
-				node->elem->assumption = false;
-			}
+			fexpr_set_assumption(
+				data, e,
+				has_value && !strcmp(str_get(&e->nb_val),
+						     string_val));
 		}
 	}
 }
 
+static struct cfdata *assumption_data;
+
+static void assumption_sym_changed(struct symbol *sym)
+{
+	sym_update_assumption(assumption_data, sym);
+}
+
 /*
- * add assumption for a boolean symbol to the SAT-solver
+ * fill the assumption vector and keep it up to date with the symbol values
  */
-void sym_add_assumption_tri(PicoSAT *pico, struct symbol *sym, tristate tri_val)
+void init_assumptions(struct cfdata *data)
 {
-	if (sym->type == S_BOOLEAN) {
-		int a = sym->fexpr_y->satval;
+	struct symbol *sym;
 
-		switch (tri_val) {
-		case no:
-			picosat_assume(pico, -a);
-			sym->fexpr_y->assumption = false;
-			break;
-		case mod:
-			perror("Should not happen. Boolean symbol is set to mod.\n");
-			break;
-		case yes:
+	data->assumptions_size = data->sat_variable_nr;
+	data->assumptions = xcalloc(data->assumptions_size,
+				    sizeof(*data->assumptions));
+	data->sdv_bits = xcalloc(BITS_TO_LONGS(data->assumptions_size),
+				 sizeof(*data->sdv_bits));
 
-			picosat_assume(pico, a);
-			sym->fexpr_y->assumption = true;
-			break;
-		}
+	for_all_symbols(sym)
+		sym_update_assumption(data, sym);
+
+	assumption_data = data;
+	sym_set_changed_callback(assumption_sym_changed);
+}
+
+static void sdv_bit_assign(struct cfdata *data, struct fexpr *e, bool mark)
+{
+	unsigned long bit = 1UL << (e->satval % BITS_PER_LONG);
+
+	if (mark) {
+		data->sdv_bits[e->satval / BITS_PER_LONG] |= bit;
+	} else {
+		data->sdv_bits[e->satval / BITS_PER_LONG] &= ~bit;
+		/* restore the assumption overridden for the conflict */
+		e->assumption = data->assumptions[e->satval] > 0;
 	}
-	if (sym->type == S_TRISTATE) {
-		int a = sym->fexpr_y->satval;
-		int a_both = sym->fexpr_both->satval;
-
-		switch (tri_val) {
-		case no:
-			picosat_assume(pico, -a);
-			picosat_assume(pico, -a_both);
-			sym->fexpr_y->assumption = false;
-			sym->fexpr_both->assumption = false;
-			break;
-		case mod:
-			picosat_assume(pico, -a);
-			picosat_assume(pico, a_both);
-			sym->fexpr_y->assumption = false;
-			sym->fexpr_both->assumption = true;
-			break;
-		case yes:
-			picosat_assume(pico, a);
-			picosat_assume(pico, a_both);
-			sym->fexpr_y->assumption = true;
-			sym->fexpr_both->assumption = true;
-			break;
-		}
+}
+
+static bool sdv_bit_test(struct cfdata *data, int satval)
+{
+	return data->sdv_bits[satval / BITS_PER_LONG] &
+	       (1UL << (satval % BITS_PER_LONG));
+}
+
+/*
+ * mark or unmark the SAT variables of the conflict-symbols
+ */
+void mark_sdv_symbols(struct cfdata *data, bool mark)
+{
+	struct sdv_node *node;
+
+	CF_LIST_FOR_EACH(node, data->sdv_symbols, sdv) {
+		struct symbol *sym = node->elem->sym;
+		struct sym_cfdata *cf = sym_cf(data, sym);
+
+		sdv_bit_assign(data, cf->fexpr_y, mark);
+		if (sym->type == S_TRISTATE)
+			sdv_bit_assign(data, cf->fexpr_both, mark);
+	}
+}
+
+/*
+ * add the assumptions for all symbols except the conflict-symbols
+ */
+void sym_add_assumptions(PicoSAT *pico, struct cfdata *data)
+{
+	for (size_t i = 1; i < data->assumptions_size; i++) {
+		int lit = data->assumptions[i];
+
+		if (lit && !sdv_bit_test(data, i))
+			picosat_assume(pico, lit);
 	}
 }
 
 /*
  * add assumptions for the symbols to be changed to the SAT solver
  */
-void sym_add_assumption_sdv(PicoSAT *pico, struct sdv_list *list)
+void sym_add_assumption_sdv(PicoSAT *pico, struct sdv_list *list,
+			    struct cfdata *data)
 {
 	struct symbol_dvalue *sdv;
 	struct sdv_node *node;
@@ -835,7 +941,7 @@ void sym_add_assumption_sdv(PicoSAT *pico, struct sdv_list *list)
 
 	CF_LIST_FOR_EACH(node, list, sdv) {
 		sdv = node->elem;
-		lit_y = sdv->sym->fexpr_y->satval;
+		lit_y = sym_cf(data, sdv->sym)->fexpr_y->satval;
 
 		if (sdv->sym->type == S_BOOLEAN) {
 			switch (sdv->tri) {
@@ -849,7 +955,7 @@ void sym_add_assumption_sdv(PicoSAT *pico, struct sdv_list *list)
 				perror("Should not happen.\n");
 			}
 		} else if (sdv->sym->type == S_TRISTATE) {
-			lit_both = sdv->sym->fexpr_both->satval;
+			lit_both = sym_cf(data, sdv->sym)->fexpr_both->satval;
 
 			switch (sdv->tri) {
 			case yes:
@@ -95,13 +95,13 @@ bool sym_nonbool_has_value_set(struct symbol *sym);
 const char *sym_get_name(struct symbol *sym);
 
 /* check whether symbol is to be changed */
-bool sym_is_sdv(struct sdv_list *list, struct symbol *sym);
+bool sym_is_sdv(struct cfdata *data, struct symbol *sym);
 
 /* print a symbol's name */
 void print_sym_name(struct symbol *sym);
 
 /* print all constraints for a symbol */
-void print_sym_constraint(struct symbol *sym);
+void print_sym_constraint(struct symbol *sym, struct cfdata *data);
 
 /* print a default map */
 void print_default_map(struct defm_list *map);
@@ -121,16 +121,26 @@ void construct_cnf_clauses(PicoSAT *pico, struct cfdata *data);
 /* add a clause to PicoSAT */
 void sat_add_clause(int num, ...);
 
+/* add the stored clauses from index from onwards to another PicoSAT instance */
+void cnf_add_clauses(PicoSAT *pico, struct cfdata *data, size_t from);
+
 /* start PicoSAT */
 void picosat_solve(PicoSAT *pico, struct cfdata *data);
 
-/* add assumption for a symbol to the SAT-solver */
-void sym_add_assumption(PicoSAT *pico, struct symbol *sym);
+/* update the assumptions for a symbol from its current value */
+void sym_update_assumption(struct cfdata *data, struct symbol *sym);
+
+/* fill the assumption vector and keep it up to date with the symbol values */
+void init_assumptions(struct cfdata *data);
+
+/* mark or unmark the SAT variables of the conflict-symbols */
+void mark_sdv_symbols(struct cfdata *data, bool mark);
 
-/* add assumption for a boolean symbol to the SAT-solver */
-void sym_add_assumption_tri(PicoSAT *pico, struct symbol *sym, tristate tri_val);
+/* add the assumptions for all symbols except the conflict-symbols */
+void sym_add_assumptions(PicoSAT *pico, struct cfdata *data);
 
 /* add assumptions for the symbols to be changed to the SAT solver */
-void sym_add_assumption_sdv(PicoSAT *pico, struct sdv_list *list);
+void sym_add_assumption_sdv(PicoSAT *pico, struct sdv_list *list,
+			    struct cfdata *data);
 
 #endif
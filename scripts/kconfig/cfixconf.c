@@ -17,6 +17,7 @@
 #include "list_types.h"
 #include "list.h"
 #include "lkc.h"
+#include "internal.h"
 #include "cf_defs.h"
 #include "picosat_functions.h"
 #include "configfix.h"
@@ -31,6 +32,10 @@
 
 static char *conf_filename;
 static const char *kconfig_name;
+/* --merge: the output file, then the base config and the fragments */
+static const char *merge_output;
+static char **merge_configs;
+static int merge_nr;
 static struct sdv_list *conflict;
 static struct sfl_list *fixes;
 static volatile sig_atomic_t interrupted;
@@ -132,8 +137,14 @@ static void usage(void)
 	const char *msg = "\
   Usage:\n\
       ./cfixconf [<Kconfig>]\n\
+      ./cfixconf <Kconfig> --merge <output> <base-config> [<fragment>...]\n\
       where <Kconfig> is the root file of the Kconfig model. If not specified,\n\
       <Kconfig> is \"Kconfig\".\n\
+\n\
+      With --merge, the fragments are layered on top of the base config in\n\
+      the given order, later ones taking precedence, and the result is\n\
+      written to <output>. For requested bool and tristate values that do\n\
+      not end up in the result, fixes are proposed.\n\
 \n\
 ";
 	fprintf(stderr, "%s", msg);
@@ -378,7 +389,7 @@ static void handle_show(struct string_list *tokens)
 	free(columns);
 }
 
-static void handle_solve(struct string_list *tokens)
+static void solve_conflict(void)
 {
 	struct sfl_list *new_fixes;
 	struct sfl_node *fix;
@@ -387,10 +398,6 @@ static void handle_solve(struct string_list *tokens)
 	bool first, trivial;
 	enum fixgen_exit_status fixgen_status;
 
-	if (list_count_nodes(&tokens->list) != 1) {
-		printf("Too many arguments, expected: show\n");
-		return;
-	}
 	if (list_empty(&conflict->list)) {
 		printf("No symbols in conflict\n");
 		return;
@@ -470,6 +477,15 @@ static void handle_solve(struct string_list *tokens)
 	fixes = new_fixes;
 }
 
+static void handle_solve(struct string_list *tokens)
+{
+	if (list_count_nodes(&tokens->list) != 1) {
+		printf("Too many arguments, expected: show\n");
+		return;
+	}
+	solve_conflict();
+}
+
 static bool parse_apply(struct string_list *tokens, long *fix_no)
 {
 	struct string_node *entry;
@@ -755,6 +771,109 @@ static void read_loop(void)
 	}
 }
 
+/* copy the value read into def[S_DEF_DEF4] over the user value */
+static bool merge_value(struct symbol *sym, const char *fragment)
+{
+	struct symbol_value *user = &sym->def[S_DEF_USER];
+	struct symbol_value *val = &sym->def[S_DEF_DEF4];
+	bool redefined = false;
+
+	switch (sym->type) {
+	case S_BOOLEAN:
+	case S_TRISTATE:
+		if (sym->flags & SYMBOL_DEF_USER)
+			redefined = user->tri != val->tri;
+		user->tri = val->tri;
+		break;
+	case S_INT:
+	case S_HEX:
+	case S_STRING:
+		if (sym->flags & SYMBOL_DEF_USER)
+			redefined = strcmp(user->val, val->val);
+		free(user->val);
+		user->val = xstrdup(val->val);
+		break;
+	default:
+		return false;
+	}
+
+	if (redefined)
+		printf("Value of %s is redefined by fragment %s\n", sym->name,
+		       fragment);
+	sym->flags |= SYMBOL_DEF_USER;
+	return true;
+}
+
+/*
+ * Layer the fragments over the base config without leaving the process. Each
+ * fragment is read into the spare def[S_DEF_DEF4] slot, so that its values can
+ * be copied over the ones read so far, and the symbols it sets are remembered
+ * to check the outcome once all are merged.
+ */
+static int merge_fragments(void)
+{
+	bool *requested;
+	struct symbol *sym;
+
+	if (conf_read_simple(merge_configs[0], S_DEF_USER))
+		fatal("Could not read %s\n", merge_configs[0]);
+
+	requested = xcalloc(sym_array_nr, sizeof(*requested));
+	for (int i = 1; i < merge_nr; i++) {
+		if (conf_read_simple(merge_configs[i], S_DEF_DEF4))
+			fatal("Could not read %s\n", merge_configs[i]);
+
+		for_all_symbols(sym)
+			if ((sym->flags & SYMBOL_DEF4) &&
+			    merge_value(sym, merge_configs[i]))
+				requested[sym->id] = true;
+	}
+	sym_clear_all_valid();
+
+	for_all_symbols(sym) {
+		struct symbol_dvalue *sdv;
+
+		if (!requested[sym->id])
+			continue;
+
+		sym_calc_value(sym);
+		if (sym_is_boolean(sym)) {
+			if (sym->curr.tri == sym->def[S_DEF_USER].tri)
+				continue;
+		} else if (!strcmp(sym->curr.val, sym->def[S_DEF_USER].val)) {
+			continue;
+		}
+
+		printf("Value requested for %s not in final config: requested %s, actual %s\n",
+		       sym->name,
+		       sym_is_boolean(sym) ?
+				tristate_get_char(sym->def[S_DEF_USER].tri) :
+				(char *)sym->def[S_DEF_USER].val,
+		       symbol_value_to_str(sym));
+		if (!sym_is_boolean(sym))
+			continue;
+
+		sdv = xmalloc(sizeof(*sdv));
+		sdv->type = SDV_BOOLEAN;
+		sdv->sym = sym;
+		sdv->tri = sym->def[S_DEF_USER].tri;
+		CF_PUSH_BACK(conflict, sdv, sdv);
+	}
+	free(requested);
+
+	if (!list_empty(&conflict->list)) {
+		if (load_picosat())
+			solve_conflict();
+		else
+			printf("Could not load PicoSAT, no fixes proposed\n");
+	}
+
+	if (conf_write(merge_output))
+		fatal("Could not write %s\n", merge_output);
+
+	return EXIT_SUCCESS;
+}
+
 static void parse_args(int argc, char *argv[])
 {
 	const char *arg;
@@ -764,6 +883,18 @@ static void parse_args(int argc, char *argv[])
 		return;
 	}
 	arg = argv[1];
+	if (argc > 2 && !strcmp(argv[2], "--merge")) {
+		if (argc < 5) {
+			fprintf(stderr, "Too few arguments for --merge\n");
+			usage();
+			exit(EXIT_FAILURE);
+		}
+		kconfig_name = arg;
+		merge_output = argv[3];
+		merge_configs = argv + 4;
+		merge_nr = argc - 4;
+		return;
+	}
 	if (argc > 2) {
 		fprintf(stderr, "Too many arguments\n");
 		usage();
@@ -790,6 +921,11 @@ static void on_int(int signum)
 int main(int argc, char *argv[])
 {
 	parse_args(argc, argv);
+	if (merge_output) {
+		conf_parse(kconfig_name);
+		conflict = CF_LIST_INIT(sdv);
+		return merge_fragments();
+	}
 	if (!load_picosat())
 		fatal("Could not load PicoSAT\n");
 	conf_parse(kconfig_name);
@@ -121,7 +121,8 @@ static void write_constraints_to_file(struct cfdata *data)
 		if (sym->type == S_UNKNOWN)
 			continue;
 
-		list_for_each_entry(node, &sym->constraints->list, node) {
+		list_for_each_entry(node, &sym_cf(data, sym)->constraints->list,
+				    node) {
 			struct gstr s = str_new();
 
 			pexpr_as_char(node->elem, &s, 0, data);
@@ -14,6 +14,7 @@
 #include <sys/time.h>
 #include <errno.h>
 
+#include <xalloc.h>
 #include "internal.h"
 #include "lkc.h"
 
@@ -37,6 +38,7 @@ enum input_mode {
 	yes2modconfig,
 	mod2yesconfig,
 	mod2noconfig,
+	batchconfig,
 };
 static enum input_mode input_mode = oldaskconfig;
 static int input_mode_opt;
@@ -604,6 +606,217 @@ static void check_conf(struct menu *menu)
 		check_conf(child);
 }
 
+/* user values of int, hex and string symbols, kept until a batch is done */
+static char **batch_strs;
+static size_t batch_strs_nr, batch_strs_alloc;
+
+static const char *batch_keep(const char *val)
+{
+	if (batch_strs_nr == batch_strs_alloc) {
+		batch_strs_alloc = batch_strs_alloc ? batch_strs_alloc * 2 : 1024;
+		batch_strs = xrealloc(batch_strs,
+				      batch_strs_alloc * sizeof(*batch_strs));
+	}
+	return batch_strs[batch_strs_nr++] = xstrdup(val);
+}
+
+static void batch_load_sym(struct sym_batch *b, unsigned int lane,
+			   struct symbol *sym)
+{
+	if (!sym_has_value(sym)) {
+		sym_batch_unset(b, lane, sym);
+		return;
+	}
+
+	switch (sym->type) {
+	case S_BOOLEAN:
+	case S_TRISTATE:
+		sym_batch_set_tristate(b, lane, sym, sym->def[S_DEF_USER].tri);
+		break;
+	case S_INT:
+	case S_HEX:
+	case S_STRING:
+		sym_batch_set_string(b, lane, sym,
+				     batch_keep(sym->def[S_DEF_USER].val));
+		break;
+	default:
+		break;
+	}
+}
+
+/* read a configuration and make its user values the ones of a lane */
+static void batch_load(struct sym_batch *b, unsigned int lane,
+		       const char *name)
+{
+	struct symbol *sym;
+
+	if (conf_read_simple(name, S_DEF_USER)) {
+		fprintf(stderr, "*** Can't read configuration \"%s\"\n", name);
+		exit(1);
+	}
+
+	for_all_symbols(sym) {
+		struct menu *choice;
+		struct symbol *member;
+
+		if (!sym_is_choice(sym)) {
+			if (!sym_get_choice_menu(sym))
+				batch_load_sym(b, lane, sym);
+			continue;
+		}
+		if (list_empty(&sym->menus))
+			continue;
+
+		/*
+		 * Set the members in reverse, so that the head of the list,
+		 * which was read last, ends up with the highest priority.
+		 */
+		choice = list_first_entry(&sym->menus, struct menu, link);
+		list_for_each_entry_reverse(member, &choice->choice_members,
+					    choice_link)
+			batch_load_sym(b, lane, member);
+	}
+}
+
+/* report the user values that were not taken and the unmet dependencies */
+static void batch_report(struct sym_batch *b, unsigned int lane,
+			 const char *name)
+{
+	struct symbol *sym;
+
+	for_all_symbols(sym) {
+		const char *user, *val;
+
+		if (!sym->name || sym->type == S_UNKNOWN)
+			continue;
+
+		user = sym_batch_get_user(b, lane, sym);
+		val = sym_batch_get_string(b, lane, sym);
+		if (user && strcmp(user, val))
+			printf("%s: %s%s=%s was set to %s\n",
+			       name, CONFIG_, sym->name, user, val);
+		if (sym_batch_get_unmet(b, sym) >> lane & 1)
+			printf("%s: unmet direct dependencies detected for %s\n",
+			       name, sym->name);
+	}
+}
+
+/*
+ * compare the values of a lane with the ones sym_calc_value() calculates for
+ * the same configuration
+ */
+static int batch_check(struct sym_batch *b, unsigned int lane,
+		       const char *name)
+{
+	struct symbol *sym;
+	int errors = 0;
+
+	if (conf_read_simple(name, S_DEF_USER)) {
+		fprintf(stderr, "*** Can't read configuration \"%s\"\n", name);
+		exit(1);
+	}
+	sym_clear_all_valid();
+
+	for_all_symbols(sym) {
+		const char *val, *batch_val;
+
+		if (!sym->name || sym->type == S_UNKNOWN)
+			continue;
+
+		sym_calc_value(sym);
+		val = sym_get_string_value(sym);
+		batch_val = sym_batch_get_string(b, lane, sym);
+		if (strcmp(val, batch_val)) {
+			fprintf(stderr, "%s: %s is %s, but %s in the batch\n",
+				name, sym->name, val, batch_val);
+			errors++;
+		}
+	}
+
+	return errors;
+}
+
+/*
+ * Evaluate the configurations listed in a file, one per line, up to
+ * SYM_BATCH_LANES at a time. If KCONFIG_BATCH_CHECK is set, the result of
+ * every lane is checked against sym_calc_value().
+ */
+static int conf_batch(const char *list)
+{
+	char *names[SYM_BATCH_LANES];
+	unsigned int nr = 0;
+	bool check, done = false;
+	char *buf = NULL;
+	size_t size = 0;
+	ssize_t len;
+	int errors = 0;
+	FILE *in;
+
+	in = fopen(list, "r");
+	if (!in) {
+		fprintf(stderr, "*** Can't open \"%s\": %s\n", list,
+			strerror(errno));
+		return 1;
+	}
+	check = getenv("KCONFIG_BATCH_CHECK");
+
+	while (!done) {
+		struct sym_batch *b;
+		struct symbol *sym;
+
+		nr = 0;
+		while (nr < SYM_BATCH_LANES) {
+			len = getline(&buf, &size, in);
+			if (len < 0) {
+				done = true;
+				break;
+			}
+			if (len && buf[len - 1] == '\n')
+				buf[--len] = '\0';
+			if (len)
+				names[nr++] = xstrdup(buf);
+		}
+		if (!nr)
+			break;
+
+		/*
+		 * The lanes start with the current user values, which are
+		 * freed by the next read, so clear the ones left over.
+		 */
+		b = sym_batch_new();
+		for (unsigned int lane = 0; lane < SYM_BATCH_LANES; lane++) {
+			if (lane < nr) {
+				batch_load(b, lane, names[lane]);
+				continue;
+			}
+			for_all_symbols(sym)
+				sym_batch_unset(b, lane, sym);
+		}
+		sym_batch_calc(b);
+
+		for (unsigned int lane = 0; lane < nr; lane++) {
+			batch_report(b, lane, names[lane]);
+			if (check)
+				errors += batch_check(b, lane, names[lane]);
+			free(names[lane]);
+		}
+
+		sym_batch_free(b);
+		while (batch_strs_nr)
+			free(batch_strs[--batch_strs_nr]);
+	}
+
+	free(buf);
+	fclose(in);
+
+	if (errors) {
+		fprintf(stderr, "*** %d values differ from sym_calc_value()\n",
+			errors);
+		return 1;
+	}
+	return 0;
+}
+
 static const struct option long_opts[] = {
 	{"help",          no_argument,       NULL,            'h'},
 	{"silent",        no_argument,       NULL,            's'},
@@ -623,6 +836,7 @@ static const struct option long_opts[] = {
 	{"yes2modconfig", no_argument,       &input_mode_opt, yes2modconfig},
 	{"mod2yesconfig", no_argument,       &input_mode_opt, mod2yesconfig},
 	{"mod2noconfig",  no_argument,       &input_mode_opt, mod2noconfig},
+	{"batchconfig",   required_argument, &input_mode_opt, batchconfig},
 	{NULL, 0, NULL, 0}
 };
 
@@ -652,6 +866,8 @@ static void conf_usage(const char *progname)
 	printf("  --yes2modconfig         Change answers from yes to mod if possible\n");
 	printf("  --mod2yesconfig         Change answers from mod to yes if possible\n");
 	printf("  --mod2noconfig          Change answers from mod to no if possible\n");
+	printf("  --batchconfig <list>    Evaluate the configs listed in <list> and report\n"
+	       "                          the values they do not get\n");
 	printf("  (If none of the above is given, --oldaskconfig is the default)\n");
 	printf("\n");
 	printf("Arguments:\n");
@@ -690,6 +906,7 @@ int main(int ac, char **av)
 				break;
 			case defconfig:
 			case savedefconfig:
+			case batchconfig:
 				defconfig_file = optarg;
 				break;
 			case randconfig:
@@ -710,6 +927,9 @@ int main(int ac, char **av)
 	conf_parse(av[optind]);
 	//zconfdump(stdout);
 
+	if (input_mode == batchconfig)
+		return conf_batch(defconfig_file);
+
 	switch (input_mode) {
 	case defconfig:
 		if (conf_read(defconfig_file)) {
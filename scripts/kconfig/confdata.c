@@ -5,6 +5,7 @@
 
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <sys/types.h>
 #include <ctype.h>
 #include <errno.h>
@@ -43,50 +44,97 @@ static bool is_dir(const char *path)
 	return S_ISDIR(st.st_mode);
 }
 
-/* return true if the given two files are the same, false otherwise */
-static bool is_same(const char *file1, const char *file2)
+/*
+ * Output is rendered into memory first, then written out in one go unless the
+ * file already has the same contents.
+ */
+struct conf_buf {
+	char *s;
+	size_t len, size;
+};
+
+static void buf_add(struct conf_buf *b, const char *s, size_t len)
+{
+	if (!len)
+		return;
+
+	if (b->len + len > b->size) {
+		b->size = b->size ? b->size * 2 : 16384;
+		if (b->size < b->len + len)
+			b->size = b->len + len;
+		b->s = xrealloc(b->s, b->size);
+	}
+	memcpy(b->s + b->len, s, len);
+	b->len += len;
+}
+
+static void buf_puts(struct conf_buf *b, const char *s)
+{
+	buf_add(b, s, strlen(s));
+}
+
+static void buf_free(struct conf_buf *b)
 {
-	int fd1, fd2;
-	struct stat st1, st2;
-	void *map1, *map2;
+	free(b->s);
+	b->s = NULL;
+	b->len = b->size = 0;
+}
+
+/* return true if the file contains exactly the buffer, false otherwise */
+static bool is_same(const char *file, const struct conf_buf *b)
+{
+	int fd;
+	struct stat st;
+	void *map;
 	bool ret = false;
 
-	fd1 = open(file1, O_RDONLY);
-	if (fd1 < 0)
+	fd = open(file, O_RDONLY);
+	if (fd < 0)
 		return ret;
 
-	fd2 = open(file2, O_RDONLY);
-	if (fd2 < 0)
-		goto close1;
+	if (fstat(fd, &st) || st.st_size != b->len)
+		goto close;
 
-	ret = fstat(fd1, &st1);
-	if (ret)
-		goto close2;
-	ret = fstat(fd2, &st2);
-	if (ret)
-		goto close2;
+	if (!b->len) {
+		ret = true;
+		goto close;
+	}
 
-	if (st1.st_size != st2.st_size)
-		goto close2;
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		goto close;
 
-	map1 = mmap(NULL, st1.st_size, PROT_READ, MAP_PRIVATE, fd1, 0);
-	if (map1 == MAP_FAILED)
-		goto close2;
+	ret = !bcmp(map, b->s, b->len);
+	munmap(map, st.st_size);
+close:
+	close(fd);
 
-	map2 = mmap(NULL, st2.st_size, PROT_READ, MAP_PRIVATE, fd2, 0);
-	if (map2 == MAP_FAILED)
-		goto close2;
+	return ret;
+}
 
-	if (bcmp(map1, map2, st1.st_size))
-		goto close2;
+/* write the buffer to a new file, returns -1 with errno set on failure */
+static int buf_write(const char *file, const struct conf_buf *b)
+{
+	size_t done = 0;
+	ssize_t ret;
+	int fd;
 
-	ret = true;
-close2:
-	close(fd2);
-close1:
-	close(fd1);
+	fd = open(file, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0)
+		return -1;
 
-	return ret;
+	while (done < b->len) {
+		ret = write(fd, b->s + done, b->len - done);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			close(fd);
+			return -1;
+		}
+		done += ret;
+	}
+
+	return close(fd);
 }
 
 /*
@@ -128,21 +176,19 @@ static int make_parent_dir(const char *path)
 	return 0;
 }
 
-static char depfile_path[PATH_MAX];
-static size_t depfile_prefix_len;
+/* the directory of the depfiles, open during conf_touch_deps() */
+static int depfile_dirfd = -1;
 
 /* touch depfile for symbol 'name' */
 static int conf_touch_dep(const char *name)
 {
 	int fd;
 
-	/* check overflow: prefix + name + '\0' must fit in buffer. */
-	if (depfile_prefix_len + strlen(name) + 1 > sizeof(depfile_path))
-		return -1;
-
-	strcpy(depfile_path + depfile_prefix_len, name);
+	/* most depfiles exist already, and only need a new timestamp */
+	if (!utimensat(depfile_dirfd, name, NULL, 0))
+		return 0;
 
-	fd = open(depfile_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	fd = openat(depfile_dirfd, name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
 	if (fd == -1)
 		return -1;
 	close(fd);
@@ -317,15 +363,122 @@ static ssize_t getline_stripped(char **lineptr, size_t *n, FILE *stream)
 	return len;
 }
 
+/* a NUL-terminated copy of a part of a line, valid until the next call */
+static char *conf_span(const char *s, size_t len)
+{
+	static char *buf;
+	static size_t size;
+
+	if (len >= size) {
+		size = len + 64;
+		buf = xrealloc(buf, size);
+	}
+	memcpy(buf, s, len);
+	buf[len] = 0;
+
+	return buf;
+}
+
+/* parse one line, without the new line, of a .config file */
+static void conf_read_line(const char *line, size_t len, int def,
+			   const char *warn_unknown)
+{
+	int def_flags = SYMBOL_DEF << def;
+	const char *sym_name, *val, *p;
+	size_t name_len, val_len;
+	struct symbol *sym;
+	struct menu *choice;
+
+	conf_lineno++;
+
+	/* behave as if the line was a C string */
+	len = strnlen(line, len);
+
+	if (!len) /* blank line */
+		return;
+
+	if (line[0] == '#') {
+		if (len < 2 + strlen(CONFIG_) || line[1] != ' ')
+			return;
+		p = line + 2;
+		if (memcmp(p, CONFIG_, strlen(CONFIG_)))
+			return;
+		sym_name = p + strlen(CONFIG_);
+		p = memchr(sym_name, ' ', line + len - sym_name);
+		if (!p)
+			return;
+		name_len = p++ - sym_name;
+		if (line + len - p != strlen("is not set") ||
+		    memcmp(p, "is not set", strlen("is not set")))
+			return;
+
+		val = "n";
+		val_len = 1;
+	} else {
+		if (len < strlen(CONFIG_) ||
+		    memcmp(line, CONFIG_, strlen(CONFIG_))) {
+			conf_warning("unexpected data: %.*s", (int)len, line);
+			return;
+		}
+
+		sym_name = line + strlen(CONFIG_);
+		p = memchr(sym_name, '=', line + len - sym_name);
+		if (!p) {
+			conf_warning("unexpected data: %.*s", (int)len, line);
+			return;
+		}
+		name_len = p - sym_name;
+		val = p + 1;
+		val_len = line + len - val;
+	}
+
+	sym = sym_find_n(sym_name, name_len);
+	if (!sym) {
+		sym_name = conf_span(sym_name, name_len);
+		if (def == S_DEF_AUTO) {
+			/*
+			 * Reading from include/config/auto.conf.
+			 * If CONFIG_FOO previously existed in auto.conf
+			 * but it is missing now, include/config/FOO
+			 * must be touched.
+			 */
+			conf_touch_dep(sym_name);
+		} else {
+			if (warn_unknown)
+				conf_warning("unknown symbol: %s", sym_name);
+
+			conf_set_changed(true);
+		}
+		return;
+	}
+
+	if (sym->flags & def_flags)
+		conf_warning("override: reassigning to symbol %s", sym->name);
+
+	if (conf_set_sym_val(sym, def, def_flags, conf_span(val, val_len)))
+		return;
+
+	/*
+	 * If this is a choice member, give it the highest priority.
+	 * If conflicting CONFIG options are given from an input file,
+	 * the last one wins.
+	 */
+	choice = sym_get_choice_menu(sym);
+	if (choice)
+		list_move(&sym->choice_link, &choice->choice_members);
+}
+
 int conf_read_simple(const char *name, int def)
 {
 	FILE *in = NULL;
 	char   *line = NULL;
 	size_t  line_asize = 0;
-	char *p, *val;
+	ssize_t len;
+	char *p, *map;
+	struct stat st;
 	struct symbol *sym;
 	int def_flags;
-	const char *warn_unknown, *sym_name;
+	const char *warn_unknown;
 
 	warn_unknown = getenv("KCONFIG_WARN_UNKNOWN_SYMBOLS");
 	if (name) {
@@ -400,78 +553,29 @@ load:
 
 	expr_invalidate_all();
 
-	while (getline_stripped(&line, &line_asize, in) != -1) {
-		struct menu *choice;
-
-		conf_lineno++;
-
-		if (!line[0]) /* blank line */
-			continue;
-
-		if (line[0] == '#') {
-			if (line[1] != ' ')
-				continue;
-			p = line + 2;
-			if (memcmp(p, CONFIG_, strlen(CONFIG_)))
-				continue;
-			sym_name = p + strlen(CONFIG_);
-			p = strchr(sym_name, ' ');
-			if (!p)
-				continue;
-			*p++ = 0;
-			if (strcmp(p, "is not set"))
-				continue;
-
-			val = "n";
-		} else {
-			if (memcmp(line, CONFIG_, strlen(CONFIG_))) {
-				conf_warning("unexpected data: %s", line);
-				continue;
-			}
-
-			sym_name = line + strlen(CONFIG_);
-			p = strchr(sym_name, '=');
-			if (!p) {
-				conf_warning("unexpected data: %s", line);
-				continue;
-			}
-			*p = 0;
-			val = p + 1;
-		}
-
-		sym = sym_find(sym_name);
-		if (!sym) {
-			if (def == S_DEF_AUTO) {
-				/*
-				 * Reading from include/config/auto.conf.
-				 * If CONFIG_FOO previously existed in auto.conf
-				 * but it is missing now, include/config/FOO
-				 * must be touched.
-				 */
-				conf_touch_dep(sym_name);
-			} else {
-				if (warn_unknown)
-					conf_warning("unknown symbol: %s", sym_name);
-
-				conf_set_changed(true);
-			}
-			continue;
+	/*
+	 * Regular files are parsed in place, reading through stdio is left for
+	 * pipes and the like.
+	 */
+	if (!fstat(fileno(in), &st) && S_ISREG(st.st_mode) && st.st_size > 0 &&
+	    (map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+			fileno(in), 0)) != MAP_FAILED) {
+		const char *end = map + st.st_size;
+
+		for (p = map; p < end; p += len + 1) {
+			const char *eol = memchr(p, '\n', end - p);
+
+			len = (eol ?: end) - p;
+			/* like getline_stripped() */
+			if (eol && len > 0 && p[len - 1] == '\r')
+				conf_read_line(p, len - 1, def, warn_unknown);
+			else
+				conf_read_line(p, len, def, warn_unknown);
 		}
-
-		if (sym->flags & def_flags)
-			conf_warning("override: reassigning to symbol %s", sym->name);
-
-		if (conf_set_sym_val(sym, def, def_flags, val))
-			continue;
-
-		/*
-		 * If this is a choice member, give it the highest priority.
-		 * If conflicting CONFIG options are given from an input file,
-		 * the last one wins.
-		 */
-		choice = sym_get_choice_menu(sym);
-		if (choice)
-			list_move(&sym->choice_link, &choice->choice_members);
+		munmap(map, st.st_size);
+	} else {
+		while ((len = getline_stripped(&line, &line_asize, in)) != -1)
+			conf_read_line(line, len, def, warn_unknown);
 	}
 	free(line);
 	fclose(in);
@@ -540,71 +644,66 @@ static const struct comment_style comment_style_c = {
 	.postfix = " */",
 };
 
-static void conf_write_heading(FILE *fp, const struct comment_style *cs)
+static void conf_write_heading(struct conf_buf *b,
+			       const struct comment_style *cs)
 {
 	if (!cs)
 		return;
 
-	fprintf(fp, "%s\n", cs->prefix);
-
-	fprintf(fp, "%s Automatically generated file; DO NOT EDIT.\n",
-		cs->decoration);
-
-	fprintf(fp, "%s %s\n", cs->decoration, rootmenu.prompt->text);
-
-	fprintf(fp, "%s\n", cs->postfix);
+	buf_puts(b, cs->prefix);
+	buf_puts(b, "\n");
+	buf_puts(b, cs->decoration);
+	buf_puts(b, " Automatically generated file; DO NOT EDIT.\n");
+	buf_puts(b, cs->decoration);
+	buf_puts(b, " ");
+	buf_puts(b, rootmenu.prompt->text);
+	buf_puts(b, "\n");
+	buf_puts(b, cs->postfix);
+	buf_puts(b, "\n");
 }
 
-/* The returned pointer must be freed on the caller side */
-static char *escape_string_value(const char *in)
+/* characters that get a backslash in a quoted string value */
+static const bool escape_table[256] = {
+	['"'] = true,
+	['\\'] = true,
+};
+
+/*
+ * Append prefix and value as a quoted string, with '"' and '\' escaped in the
+ * value. The prefix must not need escaping.
+ */
+static void buf_add_escaped(struct conf_buf *b, const char *prefix,
+			    const char *in)
 {
 	const char *p;
-	char *out;
-	size_t len;
-
-	len = strlen(in) + strlen("\"\"") + 1;
-
-	p = in;
-	while (1) {
-		p += strcspn(p, "\"\\");
-
-		if (p[0] == '\0')
-			break;
-
-		len++;
-		p++;
-	}
-
-	out = xmalloc(len);
-	out[0] = '\0';
-
-	strcat(out, "\"");
-
-	p = in;
-	while (1) {
-		len = strcspn(p, "\"\\");
-		strncat(out, p, len);
-		p += len;
 
-		if (p[0] == '\0')
-			break;
-
-		strcat(out, "\\");
-		strncat(out, p++, 1);
+	buf_add(b, "\"", 1);
+	buf_puts(b, prefix);
+	for (p = in; *p; p++) {
+		if (!escape_table[(unsigned char)*p])
+			continue;
+		buf_add(b, in, p - in);
+		buf_add(b, "\\", 1);
+		in = p;
 	}
+	buf_add(b, in, p - in);
+	buf_add(b, "\"", 1);
+}
 
-	strcat(out, "\"");
-
-	return out;
+static void buf_add_name(struct conf_buf *b, const char *prefix,
+			 struct symbol *sym)
+{
+	buf_puts(b, prefix);
+	buf_puts(b, CONFIG_);
+	buf_puts(b, sym->name);
 }
 
 enum output_n { OUTPUT_N, OUTPUT_N_AS_UNSET, OUTPUT_N_NONE };
 
-static void __print_symbol(FILE *fp, struct symbol *sym, enum output_n output_n,
-			   bool escape_string)
+static void __print_symbol(struct conf_buf *b, struct symbol *sym,
+			   enum output_n output_n, bool escape_string)
 {
 	const char *val;
-	char *escaped = NULL;
 
 	if (sym->type == S_UNKNOWN)
 		return;
@@ -613,42 +712,46 @@ static void __print_symbol(FILE *fp, struct symbol *sym, enum output_n output_n,
 
 	if ((sym->type == S_BOOLEAN || sym->type == S_TRISTATE) &&
 	    output_n != OUTPUT_N && *val == 'n') {
-		if (output_n == OUTPUT_N_AS_UNSET)
-			fprintf(fp, "# %s%s is not set\n", CONFIG_, sym->name);
+		if (output_n == OUTPUT_N_AS_UNSET) {
+			buf_add_name(b, "# ", sym);
+			buf_puts(b, " is not set\n");
+		}
 		return;
 	}
 
-	if (sym->type == S_STRING && escape_string) {
-		escaped = escape_string_value(val);
-		val = escaped;
-	}
-
-	fprintf(fp, "%s%s=%s\n", CONFIG_, sym->name, val);
-
-	free(escaped);
+	buf_add_name(b, "", sym);
+	buf_add(b, "=", 1);
+	if (sym->type == S_STRING && escape_string)
+		buf_add_escaped(b, "", val);
+	else
+		buf_puts(b, val);
+	buf_add(b, "\n", 1);
 }
 
-static void print_symbol_for_dotconfig(FILE *fp, struct symbol *sym)
+static void print_symbol_for_dotconfig(struct conf_buf *b, struct symbol *sym)
 {
-	__print_symbol(fp, sym, OUTPUT_N_AS_UNSET, true);
+	__print_symbol(b, sym, OUTPUT_N_AS_UNSET, true);
 }
 
-static void print_symbol_for_autoconf(FILE *fp, struct symbol *sym)
+static void print_symbol_for_autoconf(struct conf_buf *b, struct symbol *sym)
 {
-	__print_symbol(fp, sym, OUTPUT_N_NONE, false);
+	__print_symbol(b, sym, OUTPUT_N_NONE, false);
 }
 
 void print_symbol_for_listconfig(struct symbol *sym)
 {
-	__print_symbol(stdout, sym, OUTPUT_N, true);
+	struct conf_buf b = {};
+
+	__print_symbol(&b, sym, OUTPUT_N, true);
+	fwrite(b.s, 1, b.len, stdout);
+	buf_free(&b);
 }
 
-static void print_symbol_for_c(FILE *fp, struct symbol *sym)
+static void print_symbol_for_c(struct conf_buf *b, struct symbol *sym)
 {
 	const char *val;
 	const char *sym_suffix = "";
 	const char *val_prefix = "";
-	char *escaped = NULL;
 
 	if (sym->type == S_UNKNOWN)
 		return;
@@ -672,26 +775,26 @@ static void print_symbol_for_c(FILE *fp, struct symbol *sym)
 		if (val[0] != '0' || (val[1] != 'x' && val[1] != 'X'))
 			val_prefix = "0x";
 		break;
-	case S_STRING:
-		escaped = escape_string_value(val);
-		val = escaped;
 	default:
 		break;
 	}
 
-	fprintf(fp, "#define %s%s%s %s%s\n", CONFIG_, sym->name, sym_suffix,
-		val_prefix, val);
-
-	free(escaped);
+	buf_add_name(b, "#define ", sym);
+	buf_puts(b, sym_suffix);
+	buf_add(b, " ", 1);
+	if (sym->type == S_STRING) {
+		buf_add_escaped(b, "", val);
+	} else {
+		buf_puts(b, val_prefix);
+		buf_puts(b, val);
+	}
+	buf_add(b, "\n", 1);
 }
 
-static void print_symbol_for_rustccfg(FILE *fp, struct symbol *sym)
+static void print_symbol_for_rustccfg(struct conf_buf *b, struct symbol *sym)
 {
 	const char *val;
 	const char *val_prefix = "";
-	char *val_prefixed = NULL;
-	size_t val_prefixed_len;
-	char *escaped = NULL;
 
 	if (sym->type == S_UNKNOWN)
 		return;
@@ -713,11 +816,12 @@ static void print_symbol_for_rustccfg(FILE *fp, struct symbol *sym)
 		 * we provide an empty `--cfg CONFIG_X` here in both `y`
 		 * and `m` cases.
 		 *
-		 * Then, the common `fprintf()` below will also give us
+		 * Then, the common output below will also give us
 		 * a `--cfg CONFIG_X="y"` or `--cfg CONFIG_X="m"`, which can
 		 * be used as the equivalent of `IS_BUILTIN()`/`IS_MODULE()`.
 		 */
-		fprintf(fp, "--cfg=%s%s\n", CONFIG_, sym->name);
+		buf_add_name(b, "--cfg=", sym);
+		buf_add(b, "\n", 1);
 		break;
 	case S_HEX:
 		if (val[0] != '0' || (val[1] != 'x' && val[1] != 'X'))
@@ -727,21 +831,11 @@ static void print_symbol_for_rustccfg(FILE *fp, struct symbol *sym)
 		break;
 	}
 
-	if (strlen(val_prefix) > 0) {
-		val_prefixed_len = strlen(val) + strlen(val_prefix) + 1;
-		val_prefixed = xmalloc(val_prefixed_len);
-		snprintf(val_prefixed, val_prefixed_len, "%s%s", val_prefix, val);
-		val = val_prefixed;
-	}
-
 	/* All values get escaped: the `--cfg` option only takes strings */
-	escaped = escape_string_value(val);
-	val = escaped;
-
-	fprintf(fp, "--cfg=%s%s=%s\n", CONFIG_, sym->name, val);
-
-	free(escaped);
-	free(val_prefixed);
+	buf_add_name(b, "--cfg=", sym);
+	buf_add(b, "=", 1);
+	buf_add_escaped(b, val_prefix, val);
+	buf_add(b, "\n", 1);
 }
 
 /*
@@ -750,6 +844,7 @@ static void print_symbol_for_rustccfg(FILE *fp, struct symbol *sym)
  */
 int conf_write_defconfig(const char *filename)
 {
+	struct conf_buf b = {};
 	struct symbol *sym;
 	struct menu *menu;
 	FILE *out;
@@ -788,21 +883,24 @@ int conf_write_defconfig(const char *filename)
 			if (sym == ds && sym_get_tristate_value(sym) == yes)
 				continue;
 		}
-		print_symbol_for_dotconfig(out, sym);
+		print_symbol_for_dotconfig(&b, sym);
 	}
+	fwrite(b.s, 1, b.len, out);
 	fclose(out);
+	buf_free(&b);
 	return 0;
 }
 
 int conf_write(const char *name)
 {
-	FILE *out;
+	struct conf_buf b = {};
 	struct symbol *sym;
 	struct menu *menu;
 	const char *str;
 	char tmpname[PATH_MAX + 1], oldname[PATH_MAX + 1];
 	char *env;
 	bool need_newline = false;
+	int ret;
 
 	if (!name)
 		name = conf_get_configname();
@@ -820,19 +918,7 @@ int conf_write(const char *name)
 	if (make_parent_dir(name))
 		return -1;
 
-	env = getenv("KCONFIG_OVERWRITECONFIG");
-	if (env && *env) {
-		*tmpname = 0;
-		out = fopen(name, "w");
-	} else {
-		snprintf(tmpname, sizeof(tmpname), "%s.%d.tmp",
-			 name, (int)getpid());
-		out = fopen(tmpname, "w");
-	}
-	if (!out)
-		return 1;
-
-	conf_write_heading(out, &comment_style_pound);
+	conf_write_heading(&b, &comment_style_pound);
 
 	if (!conf_get_changed())
 		sym_clear_all_valid();
@@ -844,10 +930,9 @@ int conf_write(const char *name)
 			if (!menu_is_visible(menu))
 				goto next;
 			str = menu_get_prompt(menu);
-			fprintf(out, "\n"
-				     "#\n"
-				     "# %s\n"
-				     "#\n", str);
+			buf_puts(&b, "\n#\n# ");
+			buf_puts(&b, str);
+			buf_puts(&b, "\n#\n");
 			need_newline = false;
 		} else if (!sym_is_choice(sym) &&
 			   !(sym->flags & SYMBOL_WRITTEN)) {
@@ -855,11 +940,11 @@ int conf_write(const char *name)
 			if (!(sym->flags & SYMBOL_WRITE))
 				goto next;
 			if (need_newline) {
-				fprintf(out, "\n");
+				buf_puts(&b, "\n");
 				need_newline = false;
 			}
 			sym->flags |= SYMBOL_WRITTEN;
-			print_symbol_for_dotconfig(out, sym);
+			print_symbol_for_dotconfig(&b, sym);
 		}
 
 next:
@@ -871,7 +956,9 @@ next:
 end_check:
 		if (!menu->sym && menu_is_visible(menu) && menu != &rootmenu &&
 		    menu->prompt->type == P_MENU) {
-			fprintf(out, "# end of %s\n", menu_get_prompt(menu));
+			buf_puts(&b, "# end of ");
+			buf_puts(&b, menu_get_prompt(menu));
+			buf_puts(&b, "\n");
 			need_newline = true;
 		}
 
@@ -883,19 +970,33 @@ end_check:
 				goto end_check;
 		}
 	}
-	fclose(out);
 
 	for_all_symbols(sym)
 		sym->flags &= ~SYMBOL_WRITTEN;
 
-	if (*tmpname) {
-		if (is_same(name, tmpname)) {
+	env = getenv("KCONFIG_OVERWRITECONFIG");
+	if (env && *env) {
+		ret = buf_write(name, &b);
+		buf_free(&b);
+		if (ret)
+			return 1;
+	} else {
+		if (is_same(name, &b)) {
 			conf_message("No change to %s", name);
-			unlink(tmpname);
+			buf_free(&b);
 			conf_set_changed(false);
 			return 0;
 		}
 
+		snprintf(tmpname, sizeof(tmpname), "%s.%d.tmp",
+			 name, (int)getpid());
+		ret = buf_write(tmpname, &b);
+		buf_free(&b);
+		if (ret) {
+			unlink(tmpname);
+			return 1;
+		}
+
 		snprintf(oldname, sizeof(oldname), "%s.old", name);
 		rename(name, oldname);
 		if (rename(tmpname, name))
@@ -953,22 +1054,31 @@ static int conf_write_autoconf_cmd(const char *autoconf_name)
 
 static int conf_touch_deps(void)
 {
+	char dir[PATH_MAX];
 	const char *name, *tmp;
-	struct symbol *sym;
-	int res;
+	struct symbol *sym, **changed;
+	unsigned int nr = 0;
+	size_t len;
+	int res = 0;
 
 	name = conf_get_autoconfig_name();
 	tmp = strrchr(name, '/');
-	depfile_prefix_len = tmp ? tmp - name + 1 : 0;
-	if (depfile_prefix_len + 1 > sizeof(depfile_path))
+	len = tmp ? tmp - name + 1 : 0;
+	if (len + 2 > sizeof(dir))
 		return -1;
 
-	strncpy(depfile_path, name, depfile_prefix_len);
-	depfile_path[depfile_prefix_len] = 0;
+	/* resolve the directory once, the depfiles are touched relative to it */
+	memcpy(dir, name, len);
+	strcpy(dir + len, ".");
+	depfile_dirfd = open(dir, O_RDONLY | O_DIRECTORY);
+	if (depfile_dirfd == -1)
+		return -1;
 
 	conf_read_simple(name, S_DEF_AUTO);
 	sym_calc_value(modules_sym);
 
+	/* find all changed symbols first, then touch their depfiles */
+	changed = xmalloc(sym_array_nr * sizeof(*changed));
 	for_all_symbols(sym) {
 		sym_calc_value(sym);
 		if (sym_is_choice(sym))
@@ -1020,49 +1130,45 @@ static int conf_touch_deps(void)
 		 *	different from 'no').
 		 */
 
-		res = conf_touch_dep(sym->name);
-		if (res)
-			return res;
+		changed[nr++] = sym;
 	}
 
-	return 0;
+	for (unsigned int i = 0; i < nr && !res; i++)
+		res = conf_touch_dep(changed[i]->name);
+
+	free(changed);
+	close(depfile_dirfd);
+	depfile_dirfd = -1;
+
+	return res;
 }
 
 static int __conf_write_autoconf(const char *filename,
-				 void (*print_symbol)(FILE *, struct symbol *),
-				 const struct comment_style *comment_style)
+				 const struct conf_buf *b)
 {
 	char tmp[PATH_MAX];
-	FILE *file;
-	struct symbol *sym;
 	int ret;
 
 	if (make_parent_dir(filename))
 		return -1;
 
+	/*
+	 * Keep the file if it is unchanged, but still update its timestamp,
+	 * which make uses to tell that syncconfig has run.
+	 */
+	if (is_same(filename, b) && !utimes(filename, NULL))
+		return 0;
+
 	ret = snprintf(tmp, sizeof(tmp), "%s.tmp", filename);
 	if (ret >= sizeof(tmp)) /* check truncation */
 		return -1;
 
-	file = fopen(tmp, "w");
-	if (!file) {
-		perror("fopen");
+	if (buf_write(tmp, b)) {
+		perror("write");
+		unlink(tmp);
 		return -1;
 	}
 
-	conf_write_heading(file, comment_style);
-
-	for_all_symbols(sym)
-		if ((sym->flags & SYMBOL_WRITE) && sym->name)
-			print_symbol(file, sym);
-
-	fflush(file);
-	/* check possible errors in conf_write_heading() and print_symbol() */
-	ret = ferror(file);
-	fclose(file);
-	if (ret)
-		return -1;
-
 	if (rename(tmp, filename)) {
 		perror("rename");
 		return -1;
@@ -1073,6 +1179,7 @@ static int __conf_write_autoconf(const char *filename,
 
 int conf_write_autoconf(int overwrite)
 {
+	struct conf_buf autoconf = {}, autoheader = {}, rustccfg = {};
 	struct symbol *sym;
 	const char *autoconf_name = conf_get_autoconfig_name();
 	int ret;
@@ -1090,30 +1197,38 @@ int conf_write_autoconf(int overwrite)
 	for_all_symbols(sym)
 		sym_calc_value(sym);
 
-	ret = __conf_write_autoconf(conf_get_autoheader_name(),
-				    print_symbol_for_c,
-				    &comment_style_c);
+	/* render all three files in one pass over the symbols */
+	conf_write_heading(&autoheader, &comment_style_c);
+	conf_write_heading(&autoconf, &comment_style_pound);
+
+	for_all_symbols(sym) {
+		if (!(sym->flags & SYMBOL_WRITE) || !sym->name)
+			continue;
+		print_symbol_for_c(&autoheader, sym);
+		print_symbol_for_rustccfg(&rustccfg, sym);
+		print_symbol_for_autoconf(&autoconf, sym);
+	}
+
+	ret = __conf_write_autoconf(conf_get_autoheader_name(), &autoheader);
 	if (ret)
-		return ret;
+		goto out;
 
-	ret = __conf_write_autoconf(conf_get_rustccfg_name(),
-				    print_symbol_for_rustccfg,
-				    NULL);
+	ret = __conf_write_autoconf(conf_get_rustccfg_name(), &rustccfg);
 	if (ret)
-		return ret;
+		goto out;
 
 	/*
 	 * Create include/config/auto.conf. This must be the last step because
 	 * Kbuild has a dependency on auto.conf and this marks the successful
 	 * completion of the previous steps.
 	 */
-	ret = __conf_write_autoconf(conf_get_autoconfig_name(),
-				    print_symbol_for_autoconf,
-				    &comment_style_pound);
-	if (ret)
-		return ret;
+	ret = __conf_write_autoconf(conf_get_autoconfig_name(), &autoconf);
+out:
+	buf_free(&autoheader);
+	buf_free(&rustccfg);
+	buf_free(&autoconf);
 
-	return 0;
+	return ret;
 }
 
 static bool conf_changed;
@@ -9,6 +9,7 @@
 #include <locale.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -26,6 +27,9 @@
 #include "list.h"
 #include "lkc.h"
 
+/* number of queries whose fixes are kept */
+#define FIX_CACHE_SIZE 8
+
 bool CFDEBUG;
 bool stop_fixgen;
 
@@ -33,7 +37,29 @@ static PicoSAT *pico;
 static bool init_done;
 static struct sym_list *conflict_syms;
 
+/* a symbol with its target value, as used in the key of the fix cache */
+struct fix_cache_sdv {
+	struct symbol *sym;
+	tristate tri;
+};
+
+struct fix_cache_entry {
+	struct fix_cache_sdv *conflict; // sorted by symbol
+	size_t conflict_nr;
+	uint64_t config_hash;
+	int *assumptions; // copy of the assumption vector the fixes are for
+	size_t assumptions_size;
+	struct sfl_list *fixes;
+};
+
+static struct fix_cache_entry fix_cache[FIX_CACHE_SIZE];
+static unsigned int fix_cache_next;
+
 static bool sdv_within_range(struct sdv_list *symbols);
+static struct sfl_list *fix_cache_lookup(struct sdv_list *symbols,
+					 struct cfdata *data);
+static void fix_cache_store(struct sdv_list *symbols, struct cfdata *data,
+			    struct sfl_list *fixes);
 static struct sfl_list *sdv_list_to_sfl_list(struct sdv_list *symbols);
 
 /* -------------------------------------- */
@@ -73,7 +99,6 @@ struct sfl_list *run_satconf_list(struct sdv_list *symbols, bool *trivial,
 {
 	clock_t start, end;
 	double time;
-	struct symbol *sym;
 	struct sdv_node *node;
 	int res;
 	struct sfl_list *ret;
@@ -144,23 +169,27 @@ struct sfl_list *run_satconf_list(struct sdv_list *symbols, bool *trivial,
 		printd("CNF-clauses added: %d\n",
 		       picosat_added_original_clauses(pico));
 
+		init_assumptions(&data);
+
 		init_done = true;
 	}
 
+	/* the same query has been answered for the current configuration */
+	ret = fix_cache_lookup(symbols, &data);
+	if (ret) {
+		printd("Using the cached fixes.\n");
+		return ret;
+	}
+
 	/* copy array with symbols to change */
 	data.sdv_symbols = CF_LIST_COPY(symbols, sdv);
+	mark_sdv_symbols(&data, true);
 
 	/* add assumptions for conflict-symbols */
-	sym_add_assumption_sdv(pico, data.sdv_symbols);
+	sym_add_assumption_sdv(pico, data.sdv_symbols, &data);
 
 	/* add assumptions for all other symbols */
-	for_all_symbols(sym) {
-		if (sym->type == S_UNKNOWN)
-			continue;
-
-		if (!sym_is_sdv(data.sdv_symbols, sym))
-			sym_add_assumption(pico, sym);
-	}
+	sym_add_assumptions(pico, &data);
 
 	printd("Solving SAT-problem...");
 	start = clock();
@@ -180,16 +209,164 @@ struct sfl_list *run_satconf_list(struct sdv_list *symbols, bool *trivial,
 		printd("\n");
 
 		ret = fixgen_run(pico, &data, status);
+
+		/* incomplete results must be recalculated next time */
+		if (*status == CFGEN_STATUS_NORMAL)
+			fix_cache_store(symbols, &data, ret);
 	} else {
 		printd("Unknown if satisfiable.\n");
 
 		ret = CF_LIST_INIT(sfl);
 	}
 
+	mark_sdv_symbols(&data, false);
 	CF_LIST_FREE(data.sdv_symbols, sdv);
 	return ret;
 }
 
+static int fix_cache_sdv_cmp(const void *a, const void *b)
+{
+	const struct fix_cache_sdv *x = a, *y = b;
+
+	if (x->sym != y->sym)
+		return (uintptr_t)x->sym < (uintptr_t)y->sym ? -1 : 1;
+
+	return (int)x->tri - (int)y->tri;
+}
+
+/*
+ * create the sorted conflict of the cache key
+ */
+static struct fix_cache_sdv *fix_cache_conflict(struct sdv_list *symbols,
+						size_t *nr)
+{
+	struct fix_cache_sdv *conflict;
+	struct sdv_node *node;
+	size_t i = 0;
+
+	*nr = list_count_nodes(&symbols->list);
+	conflict = xcalloc(*nr ? *nr : 1, sizeof(*conflict));
+	CF_LIST_FOR_EACH(node, symbols, sdv) {
+		conflict[i].sym = node->elem->sym;
+		conflict[i].tri = node->elem->tri;
+		i++;
+	}
+	qsort(conflict, *nr, sizeof(*conflict), fix_cache_sdv_cmp);
+
+	return conflict;
+}
+
+/*
+ * hash the bytes of the assumption vector for the current symbol values
+ * (FNV-1a), only used to skip entries quickly
+ */
+static uint64_t fix_cache_config_hash(struct cfdata *data)
+{
+	const unsigned char *p = (const unsigned char *)data->assumptions;
+	size_t len = data->assumptions_size * sizeof(*data->assumptions);
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	for (size_t i = 0; i < len; i++) {
+		hash ^= p[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+/*
+ * copy a list of fixes, the symbol_fix structs are shared
+ */
+static struct sfl_list *sfl_list_copy(struct sfl_list *fixes)
+{
+	CF_DEF_LIST(ret, sfl);
+	struct sfl_node *node;
+
+	CF_LIST_FOR_EACH(node, fixes, sfl)
+		CF_PUSH_BACK(ret, CF_LIST_COPY(node->elem, sfix), sfl);
+
+	return ret;
+}
+
+static void sfl_list_free(struct sfl_list *fixes)
+{
+	struct sfl_node *node;
+
+	CF_LIST_FOR_EACH(node, fixes, sfl)
+		CF_LIST_FREE(node->elem, sfix);
+	CF_LIST_FREE(fixes, sfl);
+}
+
+/*
+ * return a copy of the cached fixes for the conflict, if the configuration
+ * has not changed since they were calculated
+ */
+static struct sfl_list *fix_cache_lookup(struct sdv_list *symbols,
+					 struct cfdata *data)
+{
+	struct fix_cache_sdv *conflict;
+	struct sfl_list *ret = NULL;
+	uint64_t hash;
+	size_t nr;
+
+	conflict = fix_cache_conflict(symbols, &nr);
+	hash = fix_cache_config_hash(data);
+
+	for (int i = 0; i < FIX_CACHE_SIZE; i++) {
+		struct fix_cache_entry *entry = &fix_cache[i];
+
+		size_t j;
+
+		if (!entry->fixes || entry->config_hash != hash ||
+		    entry->conflict_nr != nr)
+			continue;
+
+		/* the hash may collide, compare the configurations in full */
+		if (entry->assumptions_size != data->assumptions_size ||
+		    memcmp(entry->assumptions, data->assumptions,
+			   data->assumptions_size * sizeof(*data->assumptions)))
+			continue;
+
+		for (j = 0; j < nr; j++)
+			if (fix_cache_sdv_cmp(&entry->conflict[j], &conflict[j]))
+				break;
+		if (j < nr)
+			continue;
+
+		ret = sfl_list_copy(entry->fixes);
+		break;
+	}
+
+	free(conflict);
+	return ret;
+}
+
+/*
+ * remember the fixes for the conflict and the current configuration
+ */
+static void fix_cache_store(struct sdv_list *symbols, struct cfdata *data,
+			    struct sfl_list *fixes)
+{
+	struct fix_cache_entry *entry = &fix_cache[fix_cache_next];
+
+	fix_cache_next = (fix_cache_next + 1) % FIX_CACHE_SIZE;
+
+	if (entry->fixes) {
+		free(entry->conflict);
+		free(entry->assumptions);
+		sfl_list_free(entry->fixes);
+	}
+
+	entry->conflict = fix_cache_conflict(symbols, &entry->conflict_nr);
+	entry->config_hash = fix_cache_config_hash(data);
+	entry->assumptions_size = data->assumptions_size;
+	entry->assumptions = xmalloc((data->assumptions_size ?: 1) *
+				     sizeof(*entry->assumptions));
+	memcpy(entry->assumptions, data->assumptions,
+	       data->assumptions_size * sizeof(*data->assumptions));
+	entry->fixes = sfl_list_copy(fixes);
+}
+
 /*
  * check whether a symbol is a conflict symbol
  */
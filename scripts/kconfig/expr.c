@@ -5,21 +5,93 @@
 
 #include <ctype.h>
 #include <errno.h>
+#include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#include <hash.h>
 #include <xalloc.h>
 #include "internal.h"
 #include "lkc.h"
 
 #define DEBUG_EXPR	0
 
-HASHTABLE_DEFINE(expr_hashtable, EXPR_HASHSIZE);
+/*
+ * Interning table for expressions: open addressing with Robin Hood hashing.
+ * The size is a power of two and the table grows at 3/4 load.
+ */
+struct expr_slot {
+	unsigned int hash;
+	struct expr *e;
+};
+
+static struct expr_slot *expr_table;
+static unsigned int expr_table_size, expr_table_nr;
+static unsigned long expr_lookups, expr_probes;
+static unsigned long expr_memo_lookups, expr_memo_hits;
+
+/* cached expression values from an older epoch are invalid */
+static unsigned int expr_epoch = 1;
 
 static struct expr *expr_eliminate_yn(struct expr *e);
 
+static unsigned int expr_hash(enum expr_type type, void *l, void *r)
+{
+	uint64_t h = (uintptr_t)l;
+
+	/* mix both pointers and the type (murmur3 finalizer) */
+	h = (h * 0x9e3779b97f4a7c15ULL) ^ (uintptr_t)r;
+	h = (h * 0x9e3779b97f4a7c15ULL) ^ (unsigned int)type;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+
+	return (unsigned int)h;
+}
+
+static void expr_table_insert(struct expr_slot *table, unsigned int size,
+			      struct expr_slot slot)
+{
+	unsigned int mask = size - 1;
+	unsigned int dist = 0;
+
+	for (unsigned int i = slot.hash & mask; ; i = (i + 1) & mask, dist++) {
+		unsigned int d;
+
+		if (!table[i].e) {
+			table[i] = slot;
+			return;
+		}
+
+		/* take the slot from an entry closer to its home */
+		d = (i - table[i].hash) & mask;
+		if (d < dist) {
+			struct expr_slot tmp = table[i];
+
+			table[i] = slot;
+			slot = tmp;
+			dist = d;
+		}
+	}
+}
+
+static void expr_table_grow(void)
+{
+	unsigned int size = expr_table_size ? expr_table_size * 2 : 4096;
+	struct expr_slot *table = xcalloc(size, sizeof(*table));
+
+	for (unsigned int i = 0; i < expr_table_size; i++)
+		if (expr_table[i].e)
+			expr_table_insert(table, size, expr_table[i]);
+
+	free(expr_table);
+	expr_table = table;
+	expr_table_size = size;
+}
+
 /**
  * expr_lookup - return the expression with the given type and sub-nodes
  * This looks up an expression with the specified type and sub-nodes. If such
@@ -32,28 +104,83 @@ static struct expr *expr_eliminate_yn(struct expr *e);
  */
 static struct expr *expr_lookup(enum expr_type type, void *l, void *r)
 {
+	struct expr_slot slot;
 	struct expr *e;
-	int hash;
+	unsigned int mask = expr_table_size - 1;
+	unsigned int hash = expr_hash(type, l, r);
+
+	expr_lookups++;
+
+	if (expr_table) {
+		unsigned int dist = 0;
+
+		for (unsigned int i = hash & mask; expr_table[i].e;
+		     i = (i + 1) & mask, dist++) {
+			expr_probes++;
 
-	hash = hash_32((unsigned int)type ^ hash_ptr(l) ^ hash_ptr(r));
+			/* the entry would have been stored before this one */
+			if (((i - expr_table[i].hash) & mask) < dist)
+				break;
 
-	hash_for_each_possible(expr_hashtable, e, node, hash) {
-		if (e->type == type && e->left._initdata == l &&
-		    e->right._initdata == r)
-			return e;
+			e = expr_table[i].e;
+			if (expr_table[i].hash == hash && e->type == type &&
+			    e->left._initdata == l && e->right._initdata == r)
+				return e;
+		}
 	}
 
 	e = xmalloc(sizeof(*e));
 	e->type = type;
 	e->left._initdata = l;
 	e->right._initdata = r;
-	e->val_is_valid = false;
+	e->val_epoch = 0;
+	e->code = 0;
 
-	hash_add(expr_hashtable, &e->node, hash);
+	if ((expr_table_nr + 1) * 4 > expr_table_size * 3)
+		expr_table_grow();
+
+	slot.hash = hash;
+	slot.e = e;
+	expr_table_insert(expr_table, expr_table_size, slot);
+	expr_table_nr++;
 
 	return e;
 }
 
+/**
+ * expr_print_table_stats - print statistics of the expression table
+ * @out: output stream
+ */
+void expr_print_table_stats(FILE *out)
+{
+	unsigned int mask = expr_table_size - 1;
+	unsigned long total = 0;
+	unsigned int max = 0;
+
+	for (unsigned int i = 0; i < expr_table_size; i++) {
+		unsigned int d;
+
+		if (!expr_table[i].e)
+			continue;
+
+		d = (i - expr_table[i].hash) & mask;
+		total += d;
+		if (d > max)
+			max = d;
+	}
+
+	fprintf(out, "expr table: %u/%u slots used (load %.2f)\n",
+		expr_table_nr, expr_table_size,
+		expr_table_size ? (double)expr_table_nr / expr_table_size : 0.0);
+	fprintf(out, "expr table: probe length avg %.2f, max %u\n",
+		expr_table_nr ? (double)total / expr_table_nr : 0.0, max);
+	fprintf(out, "expr table: %lu lookups, %.2f probes per lookup\n",
+		expr_lookups,
+		expr_lookups ? (double)expr_probes / expr_lookups : 0.0);
+	fprintf(out, "expr memo: %lu lookups, %lu hits\n",
+		expr_memo_lookups, expr_memo_hits);
+}
+
 struct expr *expr_alloc_symbol(struct symbol *sym)
 {
 	return expr_lookup(E_SYMBOL, sym, NULL);
@@ -88,41 +215,391 @@ struct expr *expr_alloc_or(struct expr *e1, struct expr *e2)
 	return e2 ? expr_alloc_two(E_OR, e1, e2) : e1;
 }
 
-static int trans_count;
+/*
+ * While the menu tree is finalized, the results of expr_transform() and
+ * expr_eliminate_dups() are remembered. Expressions are interned and never
+ * modified, so the input pointer identifies the result. Symbol types, which
+ * the results depend on, do not change in that phase.
+ */
+enum expr_memo_op {
+	EXPR_MEMO_TRANSFORM,
+	EXPR_MEMO_DUPS,
+	EXPR_MEMO_NR
+};
+
+struct expr_memo_slot {
+	struct expr *in, *out;
+	/* the warnings printed while 'out' was calculated, see expr_warn_m() */
+	unsigned int warn_start, warn_end;
+};
+
+static struct expr_memo {
+	struct expr_memo_slot *slots;
+	unsigned int size, nr;
+} expr_memo[EXPR_MEMO_NR];
+
+static bool expr_memo_active;
 
 /*
- * expr_eliminate_eq() helper.
+ * The "tested for 'm'" warnings printed by expr_transform(), logged while the
+ * memo is active so that a remembered result prints them again, as it did when
+ * it was calculated.
+ */
+struct expr_warning {
+	struct symbol *sym;
+	char forced;
+};
+
+static struct expr_warning *expr_warnings;
+static unsigned int expr_warnings_nr, expr_warnings_size;
+
+static void expr_warn_m(struct symbol *sym, char forced)
+{
+	printf("boolean symbol %s tested for 'm'? test forced to '%c'\n",
+	       sym->name, forced);
+
+	if (!expr_memo_active)
+		return;
+	if (expr_warnings_nr == expr_warnings_size) {
+		expr_warnings_size = expr_warnings_size ?
+				     expr_warnings_size * 2 : 16;
+		expr_warnings = xrealloc(expr_warnings, expr_warnings_size *
+					 sizeof(*expr_warnings));
+	}
+	expr_warnings[expr_warnings_nr].sym = sym;
+	expr_warnings[expr_warnings_nr].forced = forced;
+	expr_warnings_nr++;
+}
+
+static struct expr *expr_memo_get(enum expr_memo_op op, struct expr *in)
+{
+	struct expr_memo *memo = &expr_memo[op];
+	unsigned int mask = memo->size - 1;
+
+	expr_memo_lookups++;
+	if (!memo->slots)
+		return NULL;
+
+	/* every operation has its own table, only the input is hashed */
+	for (unsigned int i = expr_hash(E_NONE, in, NULL) & mask;
+	     memo->slots[i].in; i = (i + 1) & mask) {
+		struct expr_memo_slot *slot = &memo->slots[i];
+
+		if (slot->in != in)
+			continue;
+
+		expr_memo_hits++;
+		for (unsigned int w = slot->warn_start; w < slot->warn_end; w++)
+			expr_warn_m(expr_warnings[w].sym,
+				    expr_warnings[w].forced);
+		return slot->out;
+	}
+	return NULL;
+}
+
+static void expr_memo_insert(struct expr_memo *memo,
+			     struct expr_memo_slot slot)
+{
+	unsigned int mask = memo->size - 1;
+	unsigned int i;
+
+	for (i = expr_hash(E_NONE, slot.in, NULL) & mask; memo->slots[i].in;
+	     i = (i + 1) & mask)
+		;
+	memo->slots[i] = slot;
+}
+
+static void expr_memo_set(enum expr_memo_op op, struct expr *in,
+			  struct expr *out, unsigned int warn_start)
+{
+	struct expr_memo *memo = &expr_memo[op];
+	struct expr_memo_slot slot = { in, out, warn_start, expr_warnings_nr };
+
+	if ((memo->nr + 1) * 2 > memo->size) {
+		struct expr_memo old = *memo;
+
+		memo->size = old.size ? old.size * 2 : 1024;
+		memo->slots = xcalloc(memo->size, sizeof(*memo->slots));
+		for (unsigned int i = 0; i < old.size; i++)
+			if (old.slots[i].in)
+				expr_memo_insert(memo, old.slots[i]);
+		free(old.slots);
+	}
+	expr_memo_insert(memo, slot);
+	memo->nr++;
+}
+
+/**
+ * expr_memo_begin - start remembering simplified expressions
  *
- * Walks the two expression trees given in 'ep1' and 'ep2'. Any node that does
- * not have type 'type' (E_OR/E_AND) is considered a leaf, and is compared
- * against all other leaves. Two equal leaves are both replaced with either 'y'
- * or 'n' as appropriate for 'type', to be eliminated later.
+ * Only valid while the types of the symbols do not change.
  */
-static void __expr_eliminate_eq(enum expr_type type, struct expr **ep1, struct expr **ep2)
+void expr_memo_begin(void)
 {
-	struct expr *l, *r;
+	expr_memo_active = true;
+}
+
+/**
+ * expr_memo_end - forget all simplified expressions
+ */
+void expr_memo_end(void)
+{
+	for (int op = 0; op < EXPR_MEMO_NR; op++) {
+		free(expr_memo[op].slots);
+		expr_memo[op].slots = NULL;
+		expr_memo[op].size = expr_memo[op].nr = 0;
+	}
+	free(expr_warnings);
+	expr_warnings = NULL;
+	expr_warnings_nr = expr_warnings_size = 0;
+	expr_memo_active = false;
+}
 
-	/* Recurse down to leaves */
+static int trans_count;
+
+/* below this many leaf pairs, expr_walk_leaves() compares all of them */
+#define EXPR_LEAF_HASH_MIN	64
 
-	if ((*ep1)->type == type) {
-		l = (*ep1)->left.expr;
-		r = (*ep1)->right.expr;
-		__expr_eliminate_eq(type, &l, ep2);
-		__expr_eliminate_eq(type, &r, ep2);
-		*ep1 = expr_alloc_two(type, l, r);
+/* the leaves of an &&/|| expression, from left to right */
+struct expr_leaves {
+	struct expr **e;
+	unsigned int nr, size;
+};
+
+static void expr_collect_leaves(enum expr_type type, struct expr *e,
+				struct expr_leaves *leaves)
+{
+	if (e->type == type) {
+		expr_collect_leaves(type, e->left.expr, leaves);
+		expr_collect_leaves(type, e->right.expr, leaves);
 		return;
 	}
-	if ((*ep2)->type == type) {
-		l = (*ep2)->left.expr;
-		r = (*ep2)->right.expr;
-		__expr_eliminate_eq(type, ep1, &l);
-		__expr_eliminate_eq(type, ep1, &r);
-		*ep2 = expr_alloc_two(type, l, r);
+	if (leaves->nr == leaves->size) {
+		leaves->size = leaves->size ? leaves->size * 2 : 16;
+		leaves->e = xrealloc(leaves->e,
+				     leaves->size * sizeof(*leaves->e));
+	}
+	leaves->e[leaves->nr++] = e;
+}
+
+/* rebuild 'e' with its leaves replaced by leaves[*pos], leaves[*pos + 1], ... */
+static struct expr *expr_rebuild(enum expr_type type, struct expr *e,
+				 struct expr **leaves, unsigned int *pos)
+{
+	struct expr *l, *r;
+
+	if (e->type != type)
+		return leaves[(*pos)++];
+
+	l = expr_rebuild(type, e->left.expr, leaves, pos);
+	r = expr_rebuild(type, e->right.expr, leaves, pos);
+	return expr_alloc_two(type, l, r);
+}
+
+/*
+ * Leaves can only be equal, or be joined by expr_join_or()/expr_join_and(),
+ * if they have the same key. Leaves without a key (NULL) have to be compared
+ * against all others.
+ */
+static struct symbol *expr_leaf_key(struct expr *e)
+{
+	switch (e->type) {
+	case E_NOT:
+		e = e->left.expr;
+		if (e->type != E_SYMBOL && e->type != E_EQUAL &&
+		    e->type != E_UNEQUAL)
+			return NULL;
+		return e->left.sym;
+	case E_SYMBOL:
+	case E_EQUAL:
+	case E_UNEQUAL:
+	case E_GEQ:
+	case E_GTH:
+	case E_LEQ:
+	case E_LTH:
+		return e->left.sym;
+	default:
+		return NULL;
+	}
+}
+
+/* positions of the leaves with the same key, in increasing order */
+struct expr_bucket {
+	struct symbol *key;
+	unsigned int *pos;
+	unsigned int nr, size;
+};
+
+struct expr_buckets {
+	struct expr_bucket *table;
+	unsigned int mask;
+	struct expr_bucket unkeyed;
+};
+
+static struct expr_bucket *expr_bucket_find(struct expr_buckets *b,
+					    struct symbol *key, bool create)
+{
+	unsigned int i = expr_hash(E_NONE, key, NULL) & b->mask;
+
+	if (!key)
+		return &b->unkeyed;
+
+	for (; b->table[i].key; i = (i + 1) & b->mask)
+		if (b->table[i].key == key)
+			return &b->table[i];
+	if (!create)
+		return NULL;
+	b->table[i].key = key;
+	return &b->table[i];
+}
+
+/* index of the first position >= pos in the bucket */
+static unsigned int expr_bucket_search(struct expr_bucket *bucket,
+				       unsigned int pos)
+{
+	unsigned int lo = 0, hi = bucket->nr;
+
+	while (lo < hi) {
+		unsigned int mid = (lo + hi) / 2;
+
+		if (bucket->pos[mid] < pos)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* the first position >= pos in the bucket, UINT_MAX if there is none */
+static unsigned int expr_bucket_next(struct expr_bucket *bucket,
+				     unsigned int pos)
+{
+	unsigned int i;
+
+	if (!bucket)
+		return UINT_MAX;
+	i = expr_bucket_search(bucket, pos);
+	return i < bucket->nr ? bucket->pos[i] : UINT_MAX;
+}
+
+static void expr_bucket_add(struct expr_bucket *bucket, unsigned int pos)
+{
+	unsigned int i = expr_bucket_search(bucket, pos);
+
+	if (bucket->nr == bucket->size) {
+		bucket->size = bucket->size ? bucket->size * 2 : 4;
+		bucket->pos = xrealloc(bucket->pos,
+				       bucket->size * sizeof(*bucket->pos));
+	}
+	memmove(&bucket->pos[i + 1], &bucket->pos[i],
+		(bucket->nr - i) * sizeof(*bucket->pos));
+	bucket->pos[i] = pos;
+	bucket->nr++;
+}
+
+static void expr_bucket_del(struct expr_bucket *bucket, unsigned int pos)
+{
+	unsigned int i = expr_bucket_search(bucket, pos);
+
+	memmove(&bucket->pos[i], &bucket->pos[i + 1],
+		(bucket->nr - i - 1) * sizeof(*bucket->pos));
+	bucket->nr--;
+}
+
+/*
+ * Calls 'fn' for every leaf of 'ep1' (in order) with every leaf of 'ep2' (in
+ * order), like a plain recursive walk would, but skips the pairs of leaves
+ * with different keys once there are many of them. Those pairs are left
+ * untouched by 'fn' anyway.
+ */
+static void expr_walk_leaves(enum expr_type type,
+			     struct expr **ep1, struct expr **ep2,
+			     void (*fn)(enum expr_type type,
+					struct expr **ep1, struct expr **ep2))
+{
+	struct expr_leaves l1 = { NULL, 0, 0 }, l2 = { NULL, 0, 0 };
+	struct expr_buckets b;
+	unsigned int pos, size;
+
+	if ((*ep1)->type != type && (*ep2)->type != type) {
+		fn(type, ep1, ep2);
 		return;
 	}
 
-	/* *ep1 and *ep2 are leaves. Compare them. */
+	expr_collect_leaves(type, *ep1, &l1);
+	expr_collect_leaves(type, *ep2, &l2);
+
+	if (l1.nr * l2.nr < EXPR_LEAF_HASH_MIN) {
+		for (unsigned int i = 0; i < l1.nr; i++)
+			for (unsigned int j = 0; j < l2.nr; j++)
+				fn(type, &l1.e[i], &l2.e[j]);
+		goto rebuild;
+	}
 
+	/* room for every key of ep2, plus y and n after joins */
+	for (size = 16; size < 2 * (l2.nr + 2); size *= 2)
+		;
+	b.table = xcalloc(size, sizeof(*b.table));
+	b.mask = size - 1;
+	memset(&b.unkeyed, 0, sizeof(b.unkeyed));
+	for (unsigned int j = 0; j < l2.nr; j++)
+		expr_bucket_add(expr_bucket_find(&b, expr_leaf_key(l2.e[j]),
+						 true), j);
+
+	for (unsigned int i = 0; i < l1.nr; i++) {
+		struct symbol *key = expr_leaf_key(l1.e[i]);
+
+		for (unsigned int j = 0; j < l2.nr; j++) {
+			struct expr *old1 = l1.e[i], *old2 = l2.e[j];
+			struct symbol *key2;
+
+			if (key) {
+				unsigned int k;
+
+				k = expr_bucket_next(expr_bucket_find(&b, key,
+								      false), j);
+				j = expr_bucket_next(&b.unkeyed, j);
+				if (k < j)
+					j = k;
+				if (j >= l2.nr)
+					break;
+				old2 = l2.e[j];
+			}
+
+			fn(type, &l1.e[i], &l2.e[j]);
+
+			if (l2.e[j] != old2) {
+				key2 = expr_leaf_key(l2.e[j]);
+				if (key2 != expr_leaf_key(old2)) {
+					expr_bucket_del(expr_bucket_find(&b,
+						expr_leaf_key(old2), false), j);
+					expr_bucket_add(expr_bucket_find(&b,
+						key2, true), j);
+				}
+			}
+			if (l1.e[i] != old1)
+				key = expr_leaf_key(l1.e[i]);
+		}
+	}
+
+	for (unsigned int i = 0; i <= b.mask; i++)
+		free(b.table[i].pos);
+	free(b.table);
+	free(b.unkeyed.pos);
+
+rebuild:
+	pos = 0;
+	*ep1 = expr_rebuild(type, *ep1, l1.e, &pos);
+	pos = 0;
+	*ep2 = expr_rebuild(type, *ep2, l2.e, &pos);
+	free(l1.e);
+	free(l2.e);
+}
+
+/* __expr_eliminate_eq() helper for a pair of leaves */
+static void expr_eliminate_eq_leaves(enum expr_type type,
+				     struct expr **ep1, struct expr **ep2)
+{
 	if ((*ep1)->type == E_SYMBOL && (*ep2)->type == E_SYMBOL &&
 	    (*ep1)->left.sym == (*ep2)->left.sym &&
 	    ((*ep1)->left.sym == &symbol_yes || (*ep1)->left.sym == &symbol_no))
@@ -147,6 +624,19 @@ static void __expr_eliminate_eq(enum expr_type type, struct expr **ep1, struct e
 	}
 }
 
+/*
+ * expr_eliminate_eq() helper.
+ *
+ * Walks the two expression trees given in 'ep1' and 'ep2'. Any node that does
+ * not have type 'type' (E_OR/E_AND) is considered a leaf, and is compared
+ * against all other leaves. Two equal leaves are both replaced with either 'y'
+ * or 'n' as appropriate for 'type', to be eliminated later.
+ */
+static void __expr_eliminate_eq(enum expr_type type, struct expr **ep1, struct expr **ep2)
+{
+	expr_walk_leaves(type, ep1, ep2, expr_eliminate_eq_leaves);
+}
+
 /*
  * Rewrites the expressions 'ep1' and 'ep2' to remove operands common to both.
  * Example reductions:
@@ -469,37 +959,11 @@ static struct expr *expr_join_and(struct expr *e1, struct expr *e2)
 	return NULL;
 }
 
-/*
- * expr_eliminate_dups() helper.
- *
- * Walks the two expression trees given in 'ep1' and 'ep2'. Any node that does
- * not have type 'type' (E_OR/E_AND) is considered a leaf, and is compared
- * against all other leaves to look for simplifications.
- */
-static void expr_eliminate_dups1(enum expr_type type, struct expr **ep1, struct expr **ep2)
+/* expr_eliminate_dups1() helper for a pair of leaves */
+static void expr_eliminate_dups_leaves(enum expr_type type,
+				       struct expr **ep1, struct expr **ep2)
 {
-	struct expr *tmp, *l, *r;
-
-	/* Recurse down to leaves */
-
-	if ((*ep1)->type == type) {
-		l = (*ep1)->left.expr;
-		r = (*ep1)->right.expr;
-		expr_eliminate_dups1(type, &l, ep2);
-		expr_eliminate_dups1(type, &r, ep2);
-		*ep1 = expr_alloc_two(type, l, r);
-		return;
-	}
-	if ((*ep2)->type == type) {
-		l = (*ep2)->left.expr;
-		r = (*ep2)->right.expr;
-		expr_eliminate_dups1(type, ep1, &l);
-		expr_eliminate_dups1(type, ep1, &r);
-		*ep2 = expr_alloc_two(type, l, r);
-		return;
-	}
-
-	/* *ep1 and *ep2 are leaves. Compare and process them. */
+	struct expr *tmp;
 
 	switch (type) {
 	case E_OR:
@@ -523,6 +987,18 @@ static void expr_eliminate_dups1(enum expr_type type, struct expr **ep1, struct
 	}
 }
 
+/*
+ * expr_eliminate_dups() helper.
+ *
+ * Walks the two expression trees given in 'ep1' and 'ep2'. Any node that does
+ * not have type 'type' (E_OR/E_AND) is considered a leaf, and is compared
+ * against all other leaves to look for simplifications.
+ */
+static void expr_eliminate_dups1(enum expr_type type, struct expr **ep1, struct expr **ep2)
+{
+	expr_walk_leaves(type, ep1, ep2, expr_eliminate_dups_leaves);
+}
+
 /*
  * Rewrites 'e' in-place to remove ("join") duplicate and other redundant
  * operands.
@@ -536,10 +1012,17 @@ static void expr_eliminate_dups1(enum expr_type type, struct expr **ep1, struct
  */
 struct expr *expr_eliminate_dups(struct expr *e)
 {
+	struct expr *in = e, *out;
 	int oldcount;
 	if (!e)
 		return e;
 
+	if (expr_memo_active) {
+		out = expr_memo_get(EXPR_MEMO_DUPS, e);
+		if (out)
+			return out;
+	}
+
 	oldcount = trans_count;
 	do {
 		struct expr *l, *r;
@@ -557,6 +1040,9 @@ struct expr *expr_eliminate_dups(struct expr *e)
 		e = expr_eliminate_yn(e);
 	} while (trans_count); /* repeat until we get no more simplifications */
 	trans_count = oldcount;
+
+	if (expr_memo_active)
+		expr_memo_set(EXPR_MEMO_DUPS, in, e, expr_warnings_nr);
 	return e;
 }
 
@@ -592,8 +1078,16 @@ struct expr *expr_eliminate_dups(struct expr *e)
  */
 struct expr *expr_transform(struct expr *e)
 {
+	struct expr *in = e, *out;
+	unsigned int warn_start = expr_warnings_nr;
+
 	if (!e)
 		return NULL;
+	if (expr_memo_active) {
+		out = expr_memo_get(EXPR_MEMO_TRANSFORM, e);
+		if (out)
+			return out;
+	}
 	switch (e->type) {
 	case E_EQUAL:
 	case E_GEQ:
@@ -620,7 +1114,7 @@ struct expr *expr_transform(struct expr *e)
 		}
 		if (e->right.sym == &symbol_mod) {
 			// A=m -> n
-			printf("boolean symbol %s tested for 'm'? test forced to 'n'\n", e->left.sym->name);
+			expr_warn_m(e->left.sym, 'n');
 			e = expr_alloc_symbol(&symbol_no);
 			break;
 		}
@@ -640,7 +1134,7 @@ struct expr *expr_transform(struct expr *e)
 		}
 		if (e->right.sym == &symbol_mod) {
 			// A!=m -> y
-			printf("boolean symbol %s tested for 'm'? test forced to 'y'\n", e->left.sym->name);
+			expr_warn_m(e->left.sym, 'y');
 			e = expr_alloc_symbol(&symbol_yes);
 			break;
 		}
@@ -707,6 +1201,8 @@ struct expr *expr_transform(struct expr *e)
 	default:
 		;
 	}
+	if (expr_memo_active)
+		expr_memo_set(EXPR_MEMO_TRANSFORM, in, e, warn_start);
 	return e;
 }
 
@@ -888,13 +1384,62 @@ static enum string_value_kind expr_parse_string(const char *str,
 	       ? kind : k_string;
 }
 
+static tristate expr_relation_value(enum expr_type type,
+				    enum string_value_kind k1,
+				    const union string_value *lval,
+				    const char *str1,
+				    enum string_value_kind k2,
+				    const union string_value *rval,
+				    const char *str2)
+{
+	int res;
+
+	if (k1 == k_string || k2 == k_string)
+		res = strcmp(str1, str2);
+	else if (k1 == k_unsigned || k2 == k_unsigned)
+		res = (lval->u > rval->u) - (lval->u < rval->u);
+	else /* if (k1 == k_signed && k2 == k_signed) */
+		res = (lval->s > rval->s) - (lval->s < rval->s);
+
+	switch(type) {
+	case E_EQUAL:
+		return res ? no : yes;
+	case E_GEQ:
+		return res >= 0 ? yes : no;
+	case E_GTH:
+		return res > 0 ? yes : no;
+	case E_LEQ:
+		return res <= 0 ? yes : no;
+	case E_LTH:
+		return res < 0 ? yes : no;
+	case E_UNEQUAL:
+		return res ? yes : no;
+	default:
+		printf("expr_calc_value: relation %d?\n", type);
+		return no;
+	}
+}
+
+/* compare the values str1 and str2 of the symbols s1 and s2 */
+static tristate expr_compare_strings(enum expr_type type,
+				     struct symbol *s1, const char *str1,
+				     struct symbol *s2, const char *str2)
+{
+	enum string_value_kind k1 = k_string, k2 = k_string;
+	union string_value lval = {}, rval = {};
+
+	if (s1->type != S_STRING || s2->type != S_STRING) {
+		k1 = expr_parse_string(str1, s1->type, &lval);
+		k2 = expr_parse_string(str2, s2->type, &rval);
+	}
+
+	return expr_relation_value(type, k1, &lval, str1, k2, &rval, str2);
+}
+
 static tristate __expr_calc_value(struct expr *e)
 {
 	tristate val1, val2;
 	const char *str1, *str2;
-	enum string_value_kind k1 = k_string, k2 = k_string;
-	union string_value lval = {}, rval = {};
-	int res;
 
 	switch (e->type) {
 	case E_SYMBOL:
@@ -928,34 +1473,275 @@ static tristate __expr_calc_value(struct expr *e)
 	str1 = sym_get_string_value(e->left.sym);
 	str2 = sym_get_string_value(e->right.sym);
 
-	if (e->left.sym->type != S_STRING || e->right.sym->type != S_STRING) {
-		k1 = expr_parse_string(str1, e->left.sym->type, &lval);
-		k2 = expr_parse_string(str2, e->right.sym->type, &rval);
+	return expr_compare_strings(e->type, e->left.sym, str1,
+				    e->right.sym, str2);
+}
+
+/*
+ * Compiled expressions: after menu_finalize() the expressions the symbol values
+ * are calculated from are flattened into postfix code, which is run on a small
+ * stack instead of walking the expression tree. Symbols are referenced by id
+ * and constant symbols are folded in at compile time.
+ */
+enum expr_op {
+	OP_END,
+	OP_CONST,	/* push arg */
+	OP_SYM,		/* push the value of sym_array[arg] */
+	OP_NOT,
+	OP_AND,
+	OP_OR,
+	OP_CMP,		/* push the result of the comparison expr_cmps[arg] */
+};
+
+struct expr_insn {
+	enum expr_op op;
+	unsigned int arg;
+};
+
+/* operand of a comparison, parsed at compile time if it is constant */
+struct expr_operand {
+	struct symbol *sym;
+	bool is_const;
+	enum string_value_kind kind;
+	union string_value val;
+	const char *str;
+};
+
+struct expr_cmp {
+	enum expr_type type;
+	/* whether the operands are compared as numbers if possible */
+	bool parse;
+	struct expr_operand op[2];
+};
+
+/* expressions needing a deeper stack are not compiled */
+#define EXPR_STACK_MAX	64
+
+static struct expr_insn *expr_code;
+static unsigned int expr_code_nr, expr_code_size;
+static struct expr_cmp *expr_cmps;
+static unsigned int expr_cmps_nr, expr_cmps_size;
+
+static void expr_emit(enum expr_op op, unsigned int arg)
+{
+	if (expr_code_nr == expr_code_size) {
+		expr_code_size = expr_code_size ? expr_code_size * 2 : 4096;
+		expr_code = xrealloc(expr_code,
+				     expr_code_size * sizeof(*expr_code));
 	}
+	expr_code[expr_code_nr].op = op;
+	expr_code[expr_code_nr].arg = arg;
+	expr_code_nr++;
+}
 
-	if (k1 == k_string || k2 == k_string)
-		res = strcmp(str1, str2);
-	else if (k1 == k_unsigned || k2 == k_unsigned)
-		res = (lval.u > rval.u) - (lval.u < rval.u);
-	else /* if (k1 == k_signed && k2 == k_signed) */
-		res = (lval.s > rval.s) - (lval.s < rval.s);
+static void expr_operand_init(struct expr_operand *op, struct symbol *sym,
+			      bool parse)
+{
+	op->sym = sym;
+	op->is_const = sym->flags & SYMBOL_CONST;
+	op->kind = k_string;
+	op->val.u = 0;
+	op->str = NULL;
 
-	switch(e->type) {
+	if (!op->is_const)
+		return;
+
+	sym_calc_value(sym);
+	op->str = sym_get_string_value(sym);
+	if (parse)
+		op->kind = expr_parse_string(op->str, sym->type, &op->val);
+}
+
+static unsigned int expr_add_cmp(struct expr *e)
+{
+	struct expr_cmp *cmp;
+
+	if (expr_cmps_nr == expr_cmps_size) {
+		expr_cmps_size = expr_cmps_size ? expr_cmps_size * 2 : 256;
+		expr_cmps = xrealloc(expr_cmps,
+				     expr_cmps_size * sizeof(*expr_cmps));
+	}
+
+	cmp = &expr_cmps[expr_cmps_nr];
+	cmp->type = e->type;
+	cmp->parse = e->left.sym->type != S_STRING ||
+		     e->right.sym->type != S_STRING;
+	expr_operand_init(&cmp->op[0], e->left.sym, cmp->parse);
+	expr_operand_init(&cmp->op[1], e->right.sym, cmp->parse);
+
+	return expr_cmps_nr++;
+}
+
+/*
+ * Emit the code for e and return the stack depth it needs, or -1 if it cannot
+ * be compiled.
+ */
+static int expr_emit_tree(struct expr *e)
+{
+	struct expr *first, *second;
+	struct symbol *sym;
+	int d1, d2;
+
+	switch (e->type) {
+	case E_SYMBOL:
+		sym = e->left.sym;
+		if (sym->flags & SYMBOL_CONST) {
+			sym_calc_value(sym);
+			expr_emit(OP_CONST, sym->curr.tri);
+		} else {
+			expr_emit(OP_SYM, sym->id);
+		}
+		return 1;
+	case E_NOT:
+		d1 = expr_emit_tree(e->left.expr);
+		if (d1 < 0)
+			return -1;
+		expr_emit(OP_NOT, 0);
+		return d1;
+	case E_AND:
+	case E_OR:
+		/*
+		 * Both operands are always evaluated, so start with a nested
+		 * && or || if there is one. That keeps long chains at a stack
+		 * depth of two, whichever way they lean.
+		 */
+		first = e->left.expr;
+		second = e->right.expr;
+		if ((second->type == E_AND || second->type == E_OR) &&
+		    first->type != E_AND && first->type != E_OR) {
+			first = e->right.expr;
+			second = e->left.expr;
+		}
+		d1 = expr_emit_tree(first);
+		if (d1 < 0)
+			return -1;
+		d2 = expr_emit_tree(second);
+		if (d2 < 0)
+			return -1;
+		expr_emit(e->type == E_AND ? OP_AND : OP_OR, 0);
+		return d1 > d2 + 1 ? d1 : d2 + 1;
 	case E_EQUAL:
-		return res ? no : yes;
-	case E_GEQ:
-		return res >= 0 ? yes : no;
-	case E_GTH:
-		return res > 0 ? yes : no;
-	case E_LEQ:
-		return res <= 0 ? yes : no;
-	case E_LTH:
-		return res < 0 ? yes : no;
 	case E_UNEQUAL:
-		return res ? yes : no;
+	case E_LTH:
+	case E_LEQ:
+	case E_GTH:
+	case E_GEQ:
+		expr_emit(OP_CMP, expr_add_cmp(e));
+		return 1;
 	default:
-		printf("expr_calc_value: relation %d?\n", e->type);
-		return no;
+		return -1;
+	}
+}
+
+/**
+ * expr_compile - compile an expression for expr_calc_value()
+ * @e: expression
+ *
+ * Expressions that cannot be compiled are left to the tree walk.
+ */
+static void expr_compile(struct expr *e)
+{
+	unsigned int code_start = expr_code_nr, cmps_start = expr_cmps_nr;
+	int depth;
+
+	if (!e || e->code)
+		return;
+
+	depth = expr_emit_tree(e);
+	if (depth < 0 || depth > EXPR_STACK_MAX) {
+		expr_code_nr = code_start;
+		expr_cmps_nr = cmps_start;
+		return;
+	}
+
+	expr_emit(OP_END, 0);
+	e->code = code_start + 1;
+}
+
+/**
+ * expr_compile_all - compile the expressions symbol values are calculated from
+ *
+ * Called once the menu tree is finalized.
+ */
+void expr_compile_all(void)
+{
+	struct symbol *sym;
+	struct property *prop;
+
+	for_all_symbols(sym) {
+		expr_compile(sym->dir_dep.expr);
+		expr_compile(sym->rev_dep.expr);
+		expr_compile(sym->implied.expr);
+
+		for (prop = sym->prop; prop; prop = prop->next) {
+			expr_compile(prop->expr);
+			expr_compile(prop->visible.expr);
+		}
+	}
+}
+
+static tristate expr_run_cmp(const struct expr_cmp *cmp)
+{
+	enum string_value_kind kind[2];
+	union string_value val[2];
+	const char *str[2];
+
+	for (int i = 0; i < 2; i++)
+		if (!cmp->op[i].is_const)
+			sym_calc_value(cmp->op[i].sym);
+
+	for (int i = 0; i < 2; i++) {
+		const struct expr_operand *op = &cmp->op[i];
+
+		kind[i] = op->kind;
+		val[i] = op->val;
+		str[i] = op->str;
+		if (op->is_const)
+			continue;
+
+		str[i] = sym_get_string_value(op->sym);
+		if (cmp->parse)
+			kind[i] = expr_parse_string(str[i], op->sym->type,
+						    &val[i]);
+	}
+
+	return expr_relation_value(cmp->type, kind[0], &val[0], str[0],
+				   kind[1], &val[1], str[1]);
+}
+
+static tristate expr_run(const struct expr_insn *pc)
+{
+	tristate stack[EXPR_STACK_MAX];
+	unsigned int sp = 0;
+	struct symbol *sym;
+
+	for (;; pc++) {
+		switch (pc->op) {
+		case OP_END:
+			return stack[0];
+		case OP_CONST:
+			stack[sp++] = pc->arg;
+			break;
+		case OP_SYM:
+			sym = sym_array[pc->arg];
+			sym_calc_value(sym);
+			stack[sp++] = sym->curr.tri;
+			break;
+		case OP_NOT:
+			stack[sp - 1] = EXPR_NOT(stack[sp - 1]);
+			break;
+		case OP_AND:
+			sp--;
+			stack[sp - 1] = EXPR_AND(stack[sp - 1], stack[sp]);
+			break;
+		case OP_OR:
+			sp--;
+			stack[sp - 1] = EXPR_OR(stack[sp - 1], stack[sp]);
+			break;
+		case OP_CMP:
+			stack[sp++] = expr_run_cmp(&expr_cmps[pc->arg]);
+			break;
+		}
 	}
 }
 
@@ -969,14 +1755,212 @@ tristate expr_calc_value(struct expr *e)
 	if (!e)
 		return yes;
 
-	if (!e->val_is_valid) {
-		e->val = __expr_calc_value(e);
-		e->val_is_valid = true;
+	if (e->val_epoch != expr_epoch) {
+		e->val = e->code ? expr_run(&expr_code[e->code - 1]) :
+				   __expr_calc_value(e);
+		e->val_epoch = expr_epoch;
 	}
 
 	return e->val;
 }
 
+/*
+ * Bit-parallel evaluation for the configurations of a struct sym_batch. The
+ * same code is run as for expr_calc_value(), only on tristate_lanes.
+ */
+
+/* one possible value of a comparison operand and the lanes it is taken in */
+struct expr_lane_alt {
+	uint64_t mask;
+	const char *str;
+};
+
+/*
+ * Return the number of different values the operand sym can take in the
+ * lanes, or 0 if it has to be looked up lane by lane.
+ */
+static int expr_operand_alts(struct sym_batch *b, struct symbol *sym,
+			     struct expr_lane_alt *alt)
+{
+	struct tristate_lanes l;
+
+	if (sym->flags & SYMBOL_CONST || sym->type == S_UNKNOWN) {
+		sym_calc_value(sym);
+		alt[0].mask = ~0ULL;
+		alt[0].str = sym_get_string_value(sym);
+		return 1;
+	}
+
+	switch (sym->type) {
+	case S_BOOLEAN:
+	case S_TRISTATE:
+		sym_batch_lanes(b, sym, &l);
+		alt[0].mask = ~l.m;
+		alt[0].str = "n";
+		alt[1].mask = l.m & ~l.y;
+		alt[1].str = "m";
+		alt[2].mask = l.y;
+		alt[2].str = "y";
+		return 3;
+	default:
+		return 0;
+	}
+}
+
+static const char *expr_lane_str(struct sym_batch *b, struct symbol *sym,
+				 const struct expr_lane_alt *alt, int nr_alts,
+				 unsigned int lane)
+{
+	for (int i = 0; i < nr_alts; i++)
+		if (alt[i].mask >> lane & 1)
+			return alt[i].str;
+
+	return sym_batch_string(b, sym, lane);
+}
+
+static uint64_t expr_compare_lanes(struct sym_batch *b, enum expr_type type,
+				   struct symbol *s1, struct symbol *s2)
+{
+	struct expr_lane_alt alt1[3], alt2[3];
+	int n1, n2;
+	uint64_t res = 0;
+
+	n1 = expr_operand_alts(b, s1, alt1);
+	n2 = expr_operand_alts(b, s2, alt2);
+
+	/* both operands are bool, tristate or constant: compare each pair */
+	if (n1 && n2) {
+		for (int i = 0; i < n1; i++) {
+			for (int j = 0; j < n2; j++) {
+				uint64_t mask = alt1[i].mask & alt2[j].mask;
+
+				if (mask &&
+				    expr_compare_strings(type, s1, alt1[i].str,
+							 s2, alt2[j].str) == yes)
+					res |= mask;
+			}
+		}
+		return res;
+	}
+
+	for (unsigned int lane = 0; lane < SYM_BATCH_LANES; lane++) {
+		const char *str1 = expr_lane_str(b, s1, alt1, n1, lane);
+		const char *str2 = expr_lane_str(b, s2, alt2, n2, lane);
+
+		if (expr_compare_strings(type, s1, str1, s2, str2) == yes)
+			res |= 1ULL << lane;
+	}
+
+	return res;
+}
+
+static void expr_sym_lanes(struct sym_batch *b, struct symbol *sym,
+			   struct tristate_lanes *res)
+{
+	if (sym->flags & SYMBOL_CONST) {
+		sym_calc_value(sym);
+		*res = lanes_const(sym->curr.tri);
+	} else {
+		sym_batch_lanes(b, sym, res);
+	}
+}
+
+static void expr_run_lanes(const struct expr_insn *pc, struct sym_batch *b,
+			   struct tristate_lanes *res)
+{
+	struct tristate_lanes stack[EXPR_STACK_MAX];
+	unsigned int sp = 0;
+	const struct expr_cmp *cmp;
+
+	for (;; pc++) {
+		switch (pc->op) {
+		case OP_END:
+			*res = stack[0];
+			return;
+		case OP_CONST:
+			stack[sp++] = lanes_const(pc->arg);
+			break;
+		case OP_SYM:
+			sym_batch_lanes(b, sym_array[pc->arg], &stack[sp++]);
+			break;
+		case OP_NOT:
+			stack[sp - 1] = lanes_not(stack[sp - 1]);
+			break;
+		case OP_AND:
+			sp--;
+			stack[sp - 1] = lanes_and(stack[sp - 1], stack[sp]);
+			break;
+		case OP_OR:
+			sp--;
+			stack[sp - 1] = lanes_or(stack[sp - 1], stack[sp]);
+			break;
+		case OP_CMP:
+			cmp = &expr_cmps[pc->arg];
+			stack[sp].m = stack[sp].y =
+				expr_compare_lanes(b, cmp->type,
+						   cmp->op[0].sym,
+						   cmp->op[1].sym);
+			sp++;
+			break;
+		}
+	}
+}
+
+/**
+ * expr_calc_lanes - calculate the value of an expression in every lane
+ * @e: expression
+ * @b: the configurations
+ * @res: the values
+ */
+void expr_calc_lanes(struct expr *e, struct sym_batch *b,
+		     struct tristate_lanes *res)
+{
+	struct tristate_lanes l1, l2;
+
+	if (!e) {
+		*res = lanes_const(yes);
+		return;
+	}
+
+	if (e->code) {
+		expr_run_lanes(&expr_code[e->code - 1], b, res);
+		return;
+	}
+
+	switch (e->type) {
+	case E_SYMBOL:
+		expr_sym_lanes(b, e->left.sym, res);
+		break;
+	case E_AND:
+		expr_calc_lanes(e->left.expr, b, &l1);
+		expr_calc_lanes(e->right.expr, b, &l2);
+		*res = lanes_and(l1, l2);
+		break;
+	case E_OR:
+		expr_calc_lanes(e->left.expr, b, &l1);
+		expr_calc_lanes(e->right.expr, b, &l2);
+		*res = lanes_or(l1, l2);
+		break;
+	case E_NOT:
+		expr_calc_lanes(e->left.expr, b, &l1);
+		*res = lanes_not(l1);
+		break;
+	case E_EQUAL:
+	case E_GEQ:
+	case E_GTH:
+	case E_LEQ:
+	case E_LTH:
+	case E_UNEQUAL:
+		res->m = res->y = expr_compare_lanes(b, e->type, e->left.sym,
+						     e->right.sym);
+		break;
+	default:
+		printf("expr_calc_lanes: %d?\n", e->type);
+		*res = lanes_const(no);
+		break;
+	}
+}
+
 /**
  * expr_invalidate_all - invalidate all cached expression values
  */
@@ -984,8 +1968,16 @@ void expr_invalidate_all(void)
 {
 	struct expr *e;
 
-	hash_for_each(expr_hashtable, e, node)
-		e->val_is_valid = false;
+	if (++expr_epoch)
+		return;
+
+	/* wrapped around, old epochs might look valid again */
+	for (unsigned int i = 0; i < expr_table_size; i++) {
+		e = expr_table[i].e;
+		if (e)
+			e->val_epoch = 0;
+	}
+	expr_epoch = 1;
 }
 
 static int expr_compare_type(enum expr_type t1, enum expr_type t2)
@@ -11,6 +11,7 @@ extern "C" {
 #endif
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
 #ifndef __cplusplus
 #include <stdbool.h>
@@ -37,18 +38,18 @@ union expr_data {
 /**
  * struct expr - expression
  *
- * @node:  link node for the hash table
  * @type:  expressoin type
  * @val: calculated tristate value
- * @val_is_valid: indicate whether the value is valid
+ * @val_epoch: the value is valid if this matches the current expression epoch
+ * @code: offset + 1 of the compiled code, 0 if not compiled
  * @left:  left node
  * @right: right node
  */
 struct expr {
-	struct hlist_node node;
 	enum expr_type type;
 	tristate val;
-	bool val_is_valid;
+	unsigned int val_epoch;
+	unsigned int code;
 	union expr_data left, right;
 };
 
@@ -56,6 +57,79 @@ struct expr {
 #define EXPR_AND(dep1, dep2)	(((dep1)<(dep2))?(dep1):(dep2))
 #define EXPR_NOT(dep)		(2-(dep))
 
+/* number of configurations evaluated at once, see batch.c */
+#define SYM_BATCH_LANES		64
+
+/*
+ * A tristate value per lane, stored as two bit-planes: a bit of 'm' is set if
+ * the value in that lane is at least mod, a bit of 'y' if it is yes.
+ */
+struct tristate_lanes {
+	uint64_t m, y;
+};
+
+static inline struct tristate_lanes lanes_const(tristate val)
+{
+	struct tristate_lanes l;
+
+	l.m = val >= mod ? ~0ULL : 0;
+	l.y = val == yes ? ~0ULL : 0;
+	return l;
+}
+
+static inline struct tristate_lanes lanes_and(struct tristate_lanes a,
+					      struct tristate_lanes b)
+{
+	struct tristate_lanes l;
+
+	l.m = a.m & b.m;
+	l.y = a.y & b.y;
+	return l;
+}
+
+static inline struct tristate_lanes lanes_or(struct tristate_lanes a,
+					     struct tristate_lanes b)
+{
+	struct tristate_lanes l;
+
+	l.m = a.m | b.m;
+	l.y = a.y | b.y;
+	return l;
+}
+
+static inline struct tristate_lanes lanes_not(struct tristate_lanes a)
+{
+	struct tristate_lanes l;
+
+	l.m = ~a.y;
+	l.y = ~a.m;
+	return l;
+}
+
+/* take a in the lanes of mask and b in the others */
+static inline struct tristate_lanes lanes_select(uint64_t mask,
+						 struct tristate_lanes a,
+						 struct tristate_lanes b)
+{
+	struct tristate_lanes l;
+
+	l.m = (a.m & mask) | (b.m & ~mask);
+	l.y = (a.y & mask) | (b.y & ~mask);
+	return l;
+}
+
+/* lanes in which a is less than b */
+static inline uint64_t lanes_less(struct tristate_lanes a,
+				  struct tristate_lanes b)
+{
+	return (b.m & ~a.m) | (b.y & ~a.y);
+}
+
+static inline tristate lanes_get(struct tristate_lanes l, unsigned int lane)
+{
+	return (tristate)((l.m >> lane & 1) + (l.y >> lane & 1));
+}
+
 struct expr_value {
 	struct expr *expr;
 	tristate tri;
@@ -87,27 +161,19 @@ enum {
  * @choice_link: linked to menu::choice_members
  */
 struct symbol {
-	/* link node for the hash table */
-	struct hlist_node node;
+	/*
+	 * The fields up to 'prop' are read by sym_calc_value() and expression
+	 * evaluation and are kept together at the start.
+	 */
 
-	/* The name of the symbol, e.g. "FOO" for 'config FOO' */
-	char *name;
+	/* index in sym_array, in the order the symbols were created */
+	unsigned int id;
 
 	/* S_BOOLEAN, S_TRISTATE, ... */
 	enum symbol_type type;
 
-	/*
-	 * The calculated value of the symbol. The SYMBOL_VALID bit is set in
-	 * 'flags' when this is up to date. Note that this value might differ
-	 * from the user value set in e.g. a .config file, due to visibility.
-	 */
-	struct symbol_value curr;
-
-	/*
-	 * Values for the symbol provided from outside. def[S_DEF_USER] holds
-	 * the .config value.
-	 */
-	struct symbol_value def[S_DEF_COUNT];
+	/* SYMBOL_* flags */
+	int flags;
 
 	/*
 	 * An upper bound on the tristate value the user can set for the symbol
@@ -119,16 +185,12 @@ struct symbol {
 	 */
 	tristate visible;
 
-	/* config entries associated with this symbol */
-	struct list_head menus;
-
-	struct list_head choice_link;
-
-	/* SYMBOL_* flags */
-	int flags;
-
-	/* List of properties. See prop_type. */
-	struct property *prop;
+	/*
+	 * The calculated value of the symbol. The SYMBOL_VALID bit is set in
+	 * 'flags' when this is up to date. Note that this value might differ
+	 * from the user value set in e.g. a .config file, due to visibility.
+	 */
+	struct symbol_value curr;
 
 	/* Dependencies from enclosing menus, choices, and ifs */
 	struct expr_value dir_dep;
@@ -141,18 +203,34 @@ struct symbol {
 	 */
 	struct expr_value implied;
 
+	/* List of properties. See prop_type. */
+	struct property *prop;
+
 	/*
-	 * ConfigFix
+	 * Values for the symbol provided from outside. def[S_DEF_USER] holds
+	 * the .config value.
 	 */
-	struct fexpr *fexpr_y;
-	struct fexpr *fexpr_both;
-	struct fexpr *fexpr_sel_y;
-	struct fexpr *fexpr_sel_both;
-	struct pexpr *list_sel_y;
-	struct pexpr *list_sel_both;
-	struct fexpr *noPromptCond;
-	struct fexpr_list *nb_vals; /* list of struct fexpr_node's; used for non-booleans */
-	struct pexpr_list *constraints; /* list of constraints for symbol */
+	struct symbol_value def[S_DEF_COUNT];
+
+	/* symbols whose value depends on this symbol, see sym_build_rdeps() */
+	struct symbol **rdeps;
+	unsigned int rdeps_nr;
+
+	/* position in a topological order of the dependencies */
+	unsigned int dep_order;
+
+	/* used while collecting the dependents of a changed symbol */
+	unsigned int dep_mark;
+
+	/* The name of the symbol, e.g. "FOO" for 'config FOO' */
+	char *name;
+
+	/* config entries associated with this symbol */
+	struct list_head menus;
+
+	struct list_head choice_link;
+
+	/* the ConfigFix state lives in cfdata, see sym_cf() */
 };
 
 #define SYMBOL_CONST      0x0001  /* symbol is const */
@@ -281,6 +359,10 @@ struct menu {
 
 	/* For use by front ends that need to store auxiliary data */
 	void *data;
+
+	/* cached result of menu_is_visible(), see menu_invalidate_visibility() */
+	unsigned int visible_epoch;
+	bool visible;
 };
 
 /*
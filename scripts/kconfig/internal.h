@@ -2,20 +2,35 @@
 #ifndef INTERNAL_H
 #define INTERNAL_H
 
-#include <hashtable.h>
+#include <stdio.h>
+#include <list.h>
 
-#define SYMBOL_HASHSIZE		(1U << 14)
+/* all symbols in the order they were created, indexed by symbol::id */
+extern struct symbol **sym_array;
+extern unsigned int sym_array_nr;
 
-extern HASHTABLE_DECLARE(sym_hashtable, SYMBOL_HASHSIZE);
-
-#define for_all_symbols(sym) \
-	hash_for_each(sym_hashtable, sym, node)
-
-#define EXPR_HASHSIZE		(1U << 14)
-
-extern HASHTABLE_DECLARE(expr_hashtable, EXPR_HASHSIZE);
+#define for_all_symbols(sym)						\
+	for (unsigned int __sym_i = 0;					\
+	     ((sym) = __sym_i < sym_array_nr ? sym_array[__sym_i] : NULL);	\
+	     __sym_i++)
 
 void expr_invalidate_all(void);
+void expr_compile_all(void);
+void expr_print_table_stats(FILE *out);
+void expr_memo_begin(void);
+void expr_memo_end(void);
+
+struct expr;
+struct symbol;
+struct sym_batch;
+struct tristate_lanes;
+
+void expr_calc_lanes(struct expr *e, struct sym_batch *b,
+		     struct tristate_lanes *res);
+void sym_batch_lanes(struct sym_batch *b, struct symbol *sym,
+		     struct tristate_lanes *res);
+const char *sym_batch_string(struct sym_batch *b, struct symbol *sym,
+			     unsigned int lane);
 
 struct menu;
 
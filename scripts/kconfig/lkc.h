@@ -53,6 +53,12 @@ static inline void xfwrite(const void *str, size_t len, size_t count, FILE *out)
 /* util.c */
 const char *file_lookup(const char *name);
 
+/* snapshot.c */
+bool snapshot_load(const char *name);
+void snapshot_save(const char *name);
+void snapshot_add_file(const char *name);
+void snapshot_add_env(const char *name, const char *value);
+
 /* lexer.l */
 int yylex(void);
 
@@ -95,6 +101,7 @@ extern struct menu rootmenu;
 
 bool menu_is_empty(struct menu *menu);
 bool menu_is_visible(struct menu *menu);
+void menu_invalidate_visibility(void);
 bool menu_has_prompt(const struct menu *menu);
 const char *menu_get_prompt(const struct menu *menu);
 struct menu *menu_get_parent_menu(struct menu *menu);
@@ -104,6 +111,8 @@ void menu_get_ext_help(struct menu *menu, struct gstr *help);
 
 /* symbol.c */
 void sym_clear_all_valid(void);
+void sym_build_rdeps(void);
+void sym_build_search_index(void);
 struct symbol *sym_choice_default(struct menu *choice);
 struct symbol *sym_calc_choice(struct menu *choice);
 struct property *sym_get_range_prop(struct symbol *sym);
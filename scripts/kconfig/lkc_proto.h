@@ -20,10 +20,12 @@ bool conf_errors(void);
 /* symbol.c */
 struct symbol * sym_lookup(const char *name, int flags);
 struct symbol * sym_find(const char *name);
+struct symbol * sym_find_n(const char *name, size_t len);
 void print_symbol_for_listconfig(struct symbol *sym);
 struct symbol ** sym_re_search(const char *pattern);
 const char * sym_type_name(enum symbol_type type);
 void sym_calc_value(struct symbol *sym);
+void sym_set_changed_callback(void (*fn)(struct symbol *sym));
 bool sym_dep_errors(void);
 enum symbol_type sym_get_type(const struct symbol *sym);
 bool sym_tristate_within_range(const struct symbol *sym, tristate tri);
@@ -40,6 +42,26 @@ const char * sym_get_string_value(struct symbol *sym);
 
 const char * prop_get_type_name(enum prop_type type);
 
+/* batch.c */
+struct sym_batch *sym_batch_new(void);
+void sym_batch_free(struct sym_batch *b);
+void sym_batch_set_tristate(struct sym_batch *b, unsigned int lane,
+			    struct symbol *sym, tristate val);
+void sym_batch_set_string(struct sym_batch *b, unsigned int lane,
+			  struct symbol *sym, const char *val);
+void sym_batch_unset(struct sym_batch *b, unsigned int lane,
+		     struct symbol *sym);
+const char *sym_batch_get_user(struct sym_batch *b, unsigned int lane,
+			       struct symbol *sym);
+void sym_batch_calc(struct sym_batch *b);
+tristate sym_batch_get_tristate(struct sym_batch *b, unsigned int lane,
+				struct symbol *sym);
+const char *sym_batch_get_string(struct sym_batch *b, unsigned int lane,
+				 struct symbol *sym);
+struct tristate_lanes sym_batch_get_visible(struct sym_batch *b,
+					    struct symbol *sym);
+uint64_t sym_batch_get_unmet(struct sym_batch *b, struct symbol *sym);
+
 /* expr.c */
 void expr_print(const struct expr *e,
 		void (*fn)(void *, struct symbol *, const char *),
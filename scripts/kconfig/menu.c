@@ -505,7 +505,11 @@ static void _menu_finalize(struct menu *parent, bool inside_choice)
 
 void menu_finalize(void)
 {
+	expr_memo_begin();
 	_menu_finalize(&rootmenu, false);
+	expr_memo_end();
+	sym_build_rdeps();
+	expr_compile_all();
 }
 
 bool menu_has_prompt(const struct menu *menu)
@@ -531,7 +535,29 @@ bool menu_is_empty(struct menu *menu)
 	return(true);
 }
 
-bool menu_is_visible(struct menu *menu)
+/* cached visibilities from an older epoch are invalid */
+static unsigned int menu_visible_epoch = 1;
+
+/**
+ * menu_invalidate_visibility - invalidate the results of menu_is_visible()
+ *
+ * Called whenever a symbol changes or symbol values are invalidated.
+ */
+void menu_invalidate_visibility(void)
+{
+	struct menu *menu;
+
+	if (++menu_visible_epoch)
+		return;
+
+	/* wrapped around, old epochs might look valid again */
+	rootmenu.visible_epoch = 0;
+	menu_for_each_entry(menu)
+		menu->visible_epoch = 0;
+	menu_visible_epoch = 1;
+}
+
+static bool __menu_is_visible(struct menu *menu)
 {
 	struct menu *child;
 	struct symbol *sym;
@@ -565,6 +591,26 @@ bool menu_is_visible(struct menu *menu)
 	return false;
 }
 
+bool menu_is_visible(struct menu *menu)
+{
+	unsigned int epoch = menu_visible_epoch;
+	bool visible;
+
+	if (menu->visible_epoch == epoch)
+		return menu->visible;
+
+	visible = __menu_is_visible(menu);
+
+	/*
+	 * Symbols calculated on the way may have changed, in which case the
+	 * epoch has moved on and the result is not cached.
+	 */
+	menu->visible = visible;
+	menu->visible_epoch = epoch;
+
+	return visible;
+}
+
 const char *menu_get_prompt(const struct menu *menu)
 {
 	if (menu->prompt)
@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <time.h>
 
 #include <xalloc.h>
 #include "lkc.h"
@@ -516,10 +517,17 @@ static int choice_check_sanity(const struct menu *menu)
 
 void conf_parse(const char *name)
 {
+	struct timespec start, end;
 	struct menu *menu;
 
 	autoconf_cmd = str_new();
 
+	if (snapshot_load(name)) {
+		sym_build_search_index();
+		conf_set_changed(true);
+		return;
+	}
+
 	str_printf(&autoconf_cmd, "\ndeps_config := \\\n");
 
 	zconf_initscan(name);
@@ -539,6 +547,7 @@ void conf_parse(const char *name)
 
 	/* Variables are expanded in the parse phase. We can free them here. */
 	variable_all_del();
+	shell_jobs_wait();
 
 	if (yynerrs)
 		exit(1);
@@ -550,7 +559,17 @@ void conf_parse(const char *name)
 		menu_add_prompt(P_MENU, "Main menu", NULL);
 	}
 
+	clock_gettime(CLOCK_MONOTONIC, &start);
 	menu_finalize();
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	sym_build_search_index();
+
+	if (getenv("ZCONF_DEBUG")) {
+		expr_print_table_stats(stderr);
+		fprintf(stderr, "menu_finalize: %.3f ms\n",
+			(end.tv_sec - start.tv_sec) * 1e3 +
+			(end.tv_nsec - start.tv_nsec) / 1e6);
+	}
 
 	menu_for_each_entry(menu) {
 		struct menu *child;
@@ -568,6 +587,8 @@ void conf_parse(const char *name)
 	if (yynerrs)
 		exit(1);
 	conf_set_changed(true);
+
+	snapshot_save(name);
 }
 
 static bool zconf_endtoken(const char *tokenname,
@@ -21,6 +21,13 @@ const int *(*picosat_failed_assumptions)(PicoSAT *pico);
 int (*picosat_added_original_clauses)(PicoSAT *pico);
 int (*picosat_enable_trace_generation)(PicoSAT *pico);
 void (*picosat_print)(PicoSAT *pico, FILE *file);
+void (*picosat_adjust)(PicoSAT *pico, int max_idx);
+void (*picosat_set_seed)(PicoSAT *pico, unsigned int seed);
+void (*picosat_set_global_default_phase)(PicoSAT *pico, int phase);
+void (*picosat_set_interrupt)(PicoSAT *pico, void *state,
+			      int (*interrupted)(void *state));
+
+static bool portfolio_functions_loaded;
 
 #define PICOSAT_FUNCTION_LIST              \
 	X(picosat_init)                    \
@@ -33,6 +40,12 @@ void (*picosat_print)(PicoSAT *pico, FILE *file);
 	X(picosat_enable_trace_generation) \
 	X(picosat_print)
 
+#define PICOSAT_OPTIONAL_FUNCTION_LIST      \
+	X(picosat_adjust)                   \
+	X(picosat_set_seed)                 \
+	X(picosat_set_global_default_phase) \
+	X(picosat_set_interrupt)
+
 static void load_function(const char *name, void **ptr, void *handle,
 			  bool *failed)
 {
@@ -69,11 +82,21 @@ bool load_picosat(void)
 #define X(name) load_function(#name, (void **) &name, handle, &failed);
 
 	PICOSAT_FUNCTION_LIST
-#undef X
 
 	if (failed) {
 		dlclose(handle);
 		return false;
-	} else
-		return true;
+	}
+
+	/* older libraries lack these, which only disables the portfolio */
+	PICOSAT_OPTIONAL_FUNCTION_LIST
+#undef X
+
+	portfolio_functions_loaded = !failed;
+	return true;
+}
+
+bool picosat_has_portfolio_functions(void)
+{
+	return portfolio_functions_loaded;
 }
@@ -26,8 +26,18 @@ extern int (*picosat_added_original_clauses)(PicoSAT *pico);
 extern int (*picosat_enable_trace_generation)(PicoSAT *pico);
 extern void (*picosat_print)(PicoSAT *pico, FILE *file);
 
+/* optional, NULL if the library does not provide them */
+extern void (*picosat_adjust)(PicoSAT *pico, int max_idx);
+extern void (*picosat_set_seed)(PicoSAT *pico, unsigned int seed);
+extern void (*picosat_set_global_default_phase)(PicoSAT *pico, int phase);
+extern void (*picosat_set_interrupt)(PicoSAT *pico, void *state,
+				     int (*interrupted)(void *state));
+
 bool load_picosat(void);
 
+/* check whether the optional functions needed for a portfolio were loaded */
+bool picosat_has_portfolio_functions(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -3,13 +3,24 @@
 // Copyright (C) 2018 Masahiro Yamada <yamada.masahiro@socionext.com>
 
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
 #include <array_size.h>
+#include <hash.h>
+#include <hashtable.h>
 #include <list.h>
 #include <xalloc.h>
 #include "internal.h"
@@ -18,6 +29,7 @@
 
 static char *expand_string_with_args(const char *in, int argc, char *argv[]);
 static char *expand_string(const char *in);
+static void expansion_set_impure(void);
 
 static void __attribute__((noreturn)) pperror(const char *format, ...)
 {
@@ -100,6 +112,7 @@ void env_write_dep(struct gstr *s)
 			   "$(autoconfig): FORCE\n"
 			   "endif\n",
 			   e->name, e->value);
+		snapshot_add_env(e->name, e->value);
 		env_del(e);
 	}
 }
@@ -143,25 +156,369 @@ static char *do_lineno(int argc, char *argv[])
 	return xstrdup(buf);
 }
 
-static char *do_shell(int argc, char *argv[])
+/*
+ * Cache of $(shell ...) results, kept in the file named by KCONFIG_SHELL_CACHE.
+ *
+ * A result is reused if the command, the PATH and locale variables, and the
+ * path, size and modification time of every program named in the command are
+ * the same as when it was stored. Each line of the file holds a hash of all of
+ * those, a hash of the command and variables alone, and the result. New results
+ * are appended, a later line replaces the earlier ones with the same command
+ * and variables, which are only left over when a program has changed. Once a
+ * parse has seen such lines, it removes them from the file at the end. All
+ * accesses lock the file, so kconfig runs in parallel and in other trees can
+ * share it. Removing the file drops all results, which is needed if a probe
+ * depends on something else, like a compiler plugin that was rebuilt.
+ */
+static const char * const shell_cache_env[] = {
+	"PATH", "LANG", "LC_ALL", "LC_MESSAGES",
+};
+
+struct shell_cache {
+	uint64_t *key;
+	char **result;
+	unsigned int size, nr;
+};
+
+static const char *shell_cache_name;
+static struct shell_cache shell_cache;	/* results by key */
+static struct shell_cache shell_groups;	/* keys by command and variables */
+static unsigned int shell_cache_stale;	/* lines in the file to drop */
+static bool shell_loaded;
+
+static uint64_t shell_hash(uint64_t h, const void *p, size_t len)
 {
-	FILE *p;
+	const unsigned char *c = p;
+
+	/* FNV-1a */
+	for (size_t i = 0; i < len; i++)
+		h = (h ^ c[i]) * 0x100000001b3ULL;
+	return h;
+}
+
+static uint64_t shell_hash_str(uint64_t h, const char *s)
+{
+	return shell_hash(h, s, strlen(s) + 1);
+}
+
+/* find the program 'word' like the shell would, false if there is none */
+static bool shell_find_program(const char *word, char *path, struct stat *st)
+{
+	const char *dirs, *end;
+
+	if (strchr(word, '/')) {
+		snprintf(path, PATH_MAX, "%s", word);
+		return !stat(path, st) && S_ISREG(st->st_mode);
+	}
+
+	dirs = getenv("PATH");
+	for (; dirs && *dirs; dirs = *end ? end + 1 : end) {
+		end = dirs + strcspn(dirs, ":");
+		if (snprintf(path, PATH_MAX, "%.*s/%s", (int)(end - dirs),
+			     dirs, word) >= PATH_MAX)
+			continue;
+		if (!stat(path, st) && S_ISREG(st->st_mode) &&
+		    st->st_mode & 0111)
+			return true;
+	}
+	return false;
+}
+
+/* @group: returns the hash of the command and the variables alone */
+static uint64_t shell_cache_key(const char *cmd, uint64_t *group)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	const char *p = cmd;
+
+	h = shell_hash_str(h, cmd);
+	for (int i = 0; i < ARRAY_SIZE(shell_cache_env); i++) {
+		const char *value = getenv(shell_cache_env[i]);
+
+		h = shell_hash_str(h, value ?: "");
+	}
+	/* 0 marks a free slot */
+	*group = h ?: 1;
+
+	/* every word that names a program, usually the compiler and scripts */
+	while (*p) {
+		char word[PATH_MAX], path[PATH_MAX];
+		struct stat st;
+		size_t len;
+
+		p += strspn(p, " \t\"'");
+		len = strcspn(p, " \t\"'");
+		if (!len)
+			break;
+		if (*p != '-' && len < sizeof(word)) {
+			memcpy(word, p, len);
+			word[len] = 0;
+			if (shell_find_program(word, path, &st)) {
+				int64_t id[3] = { st.st_size, st.st_mtim.tv_sec,
+						  st.st_mtim.tv_nsec };
+
+				h = shell_hash_str(h, path);
+				h = shell_hash(h, id, sizeof(id));
+			}
+		}
+		p += len;
+	}
+
+	return h ?: 1;
+}
+
+static void shell_cache_insert(struct shell_cache *c, uint64_t key,
+			       char *result)
+{
+	unsigned int mask = c->size - 1;
+	unsigned int i;
+
+	for (i = key & mask; c->key[i]; i = (i + 1) & mask) {
+		if (c->key[i] == key) {
+			free(c->result[i]);
+			c->result[i] = result;
+			return;
+		}
+	}
+	c->key[i] = key;
+	c->result[i] = result;
+	c->nr++;
+}
+
+static void shell_cache_add(struct shell_cache *c, uint64_t key, char *result)
+{
+	if ((c->nr + 1) * 2 > c->size) {
+		struct shell_cache old = *c;
+
+		c->size = old.size ? old.size * 2 : 256;
+		c->key = xcalloc(c->size, sizeof(*c->key));
+		c->result = xcalloc(c->size, sizeof(*c->result));
+		c->nr = 0;
+		for (unsigned int i = 0; i < old.size; i++)
+			if (old.key[i])
+				shell_cache_insert(c, old.key[i],
+						   old.result[i]);
+		free(old.key);
+		free(old.result);
+	}
+	shell_cache_insert(c, key, result);
+}
+
+static bool shell_cache_has(struct shell_cache *c, uint64_t key)
+{
+	unsigned int mask = c->size - 1;
+
+	if (!c->size)
+		return false;
+	for (unsigned int i = key & mask; c->key[i]; i = (i + 1) & mask)
+		if (c->key[i] == key)
+			return true;
+	return false;
+}
+
+static const char *shell_cache_get(struct shell_cache *c, uint64_t key)
+{
+	unsigned int mask = c->size - 1;
+
+	if (!c->size)
+		return NULL;
+	for (unsigned int i = key & mask; c->key[i]; i = (i + 1) & mask)
+		if (c->key[i] == key)
+			return c->result[i];
+	return NULL;
+}
+
+static void shell_cache_free(struct shell_cache *c)
+{
+	for (unsigned int i = 0; i < c->size; i++)
+		free(c->result[i]);
+	free(c->key);
+	free(c->result);
+	memset(c, 0, sizeof(*c));
+}
+
+/*
+ * parse a line "<key> <group> <result>" of the cache file, the new line is
+ * removed already
+ */
+static bool shell_cache_parse(char *line, uint64_t *key, uint64_t *group,
+			      char **result)
+{
+	char *end;
+
+	if (!isxdigit(line[0]))
+		return false;
+	*key = strtoull(line, &end, 16);
+	if (end != line + 16 || *end != ' ' || !*key)
+		return false;
+	line = end + 1;
+	if (!isxdigit(line[0]))
+		return false;
+	*group = strtoull(line, &end, 16);
+	if (end != line + 16 || *end != ' ' || !*group)
+		return false;
+	*result = end + 1;
+	return true;
+}
+
+static void shell_cache_load(void)
+{
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	FILE *f;
+
+	f = fopen(shell_cache_name, "r");
+	if (!f)
+		return;
+	flock(fileno(f), LOCK_SH);
+
+	while ((len = getline(&line, &size, f)) > 0) {
+		uint64_t key, group;
+		char *result;
+
+		if (line[len - 1] != '\n') {
+			shell_cache_stale++;
+			continue;
+		}
+		line[len - 1] = 0;
+		if (!shell_cache_parse(line, &key, &group, &result)) {
+			shell_cache_stale++;
+			continue;
+		}
+		shell_cache_add(&shell_cache, key, xstrdup(result));
+		/* the result of an older program, or a copy */
+		if (shell_cache_has(&shell_groups, group))
+			shell_cache_stale++;
+		else
+			shell_cache_add(&shell_groups, group, NULL);
+	}
+	free(line);
+	fclose(f);
+}
+
+static void shell_cache_store(uint64_t key, uint64_t group, const char *result)
+{
+	FILE *f;
+
+	shell_cache_add(&shell_cache, key, xstrdup(result));
+	if (shell_cache_has(&shell_groups, group))
+		shell_cache_stale++;
+	else
+		shell_cache_add(&shell_groups, group, NULL);
+
+	/* single lines in append mode, for other kconfig runs in parallel */
+	f = fopen(shell_cache_name, "a");
+	if (!f)
+		return;
+	flock(fileno(f), LOCK_EX);
+	fprintf(f, "%016llx %016llx %s\n", (unsigned long long)key,
+		(unsigned long long)group, result);
+	fclose(f);
+}
+
+/* keep only the last line for each command and variables in the file */
+static void shell_cache_compact(void)
+{
+	struct shell_cache lines = {};
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	FILE *f;
+
+	f = fopen(shell_cache_name, "r+");
+	if (!f)
+		return;
+	flock(fileno(f), LOCK_EX);
+
+	/* read it again, other runs may have added lines since it was loaded */
+	while ((len = getline(&line, &size, f)) > 0) {
+		uint64_t key, group;
+		char *result;
+
+		if (line[len - 1] != '\n')
+			continue;
+		line[len - 1] = 0;
+		if (shell_cache_parse(line, &key, &group, &result))
+			shell_cache_add(&lines, group, xstrdup(line));
+	}
+
+	rewind(f);
+	for (unsigned int i = 0; i < lines.size; i++)
+		if (lines.key[i])
+			fprintf(f, "%s\n", lines.result[i]);
+	fflush(f);
+	if (!ferror(f) && ftruncate(fileno(f), ftell(f)))
+		perror(shell_cache_name);
+	fclose(f);
+
+	free(line);
+	shell_cache_free(&lines);
+}
+
+/*
+ * The commands run by $(shell ...) in the last parse are kept in the file named
+ * by KCONFIG_SHELL_PREFETCH, one per line. When a parse starts, the ones
+ * without a cached result are run in the background, at most one per CPU at a
+ * time, so that their results are usually there by the time the parser gets to
+ * them. Without KCONFIG_SHELL_CACHE, all of them are run, and each result is
+ * used once. The file is replaced at the end of a parse that ran other
+ * commands, so each tree and ARCH should have its own.
+ */
+struct shell_job {
+	char *cmd;
+	uint64_t key, group;
+	pid_t pid;
+	int fd;			/* -1 if not running */
+	bool started, done;
+	char *result;		/* until do_shell() takes it */
+	size_t len;
 	char buf[4096];
+};
+
+struct shell_cmd {
 	char *cmd;
-	size_t nread;
-	int i;
+	bool listed;		/* in the file */
+	bool requested;		/* by $(shell ...) in this parse */
+};
 
-	cmd = argv[0];
+static const char *shell_prefetch_name;
 
-	p = popen(cmd, "r");
-	if (!p) {
-		perror(cmd);
-		exit(1);
+static struct shell_cmd *shell_cmds;
+static unsigned int shell_cmds_nr, shell_cmds_size;
+
+static struct shell_job *shell_jobs;
+static unsigned int shell_jobs_nr, shell_jobs_next, shell_jobs_running;
+static unsigned int shell_jobs_max;
+
+static struct shell_cmd *shell_cmd_get(const char *cmd)
+{
+	struct shell_cmd *c;
+
+	for (unsigned int i = 0; i < shell_cmds_nr; i++)
+		if (!strcmp(shell_cmds[i].cmd, cmd))
+			return &shell_cmds[i];
+
+	if (shell_cmds_nr == shell_cmds_size) {
+		shell_cmds_size = shell_cmds_size ? shell_cmds_size * 2 : 64;
+		shell_cmds = xrealloc(shell_cmds,
+				      shell_cmds_size * sizeof(*shell_cmds));
 	}
+	c = &shell_cmds[shell_cmds_nr++];
+	c->cmd = xstrdup(cmd);
+	c->listed = c->requested = false;
+	return c;
+}
 
-	nread = fread(buf, 1, sizeof(buf), p);
-	if (nread == sizeof(buf))
-		nread--;
+/* a command with a new line cannot be listed, it would not be read back */
+static bool shell_cmd_listable(const char *cmd)
+{
+	return *cmd && !strchr(cmd, '\n');
+}
+
+/* turn the first 4095 bytes of output into the result of $(shell ...) */
+static char *shell_output(char *buf, size_t nread)
+{
+	size_t i;
 
 	/* remove trailing new lines */
 	while (nread > 0 && buf[nread - 1] == '\n')
@@ -175,12 +532,309 @@ static char *do_shell(int argc, char *argv[])
 			buf[i] = ' ';
 	}
 
+	return xstrdup(buf);
+}
+
+static void shell_job_start(struct shell_job *job)
+{
+	int fds[2];
+
+	job->started = true;
+	if (pipe(fds)) {
+		perror(job->cmd);
+		exit(1);
+	}
+	/* later children must not keep the pipe open */
+	fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+
+	fflush(NULL);
+	job->pid = fork();
+	if (job->pid < 0) {
+		perror(job->cmd);
+		exit(1);
+	}
+	if (!job->pid) {
+		dup2(fds[1], STDOUT_FILENO);
+		close(fds[0]);
+		close(fds[1]);
+		execl("/bin/sh", "sh", "-c", job->cmd, (char *)NULL);
+		_exit(127);
+	}
+	close(fds[1]);
+	job->fd = fds[0];
+	shell_jobs_running++;
+}
+
+static void shell_job_finish(struct shell_job *job)
+{
+	/* like pclose(), the command gets SIGPIPE if it has more to say */
+	close(job->fd);
+	job->fd = -1;
+	while (waitpid(job->pid, NULL, 0) < 0 && errno == EINTR)
+		;
+	shell_jobs_running--;
+	job->done = true;
+
+	/* like the fread() in shell_run() */
+	if (job->len == sizeof(job->buf))
+		job->len--;
+	job->result = shell_output(job->buf, job->len);
+	if (shell_cache_name)
+		shell_cache_store(job->key, job->group, job->result);
+}
+
+/* read what the running jobs have written, waiting for some if 'block' */
+static void shell_jobs_pump(bool block)
+{
+	struct pollfd *pfd;
+	unsigned int n = 0;
+
+	while (shell_jobs_running < shell_jobs_max &&
+	       shell_jobs_next < shell_jobs_nr) {
+		struct shell_job *job = &shell_jobs[shell_jobs_next++];
+
+		if (!job->started)
+			shell_job_start(job);
+	}
+	if (!shell_jobs_running)
+		return;
+
+	pfd = xmalloc(shell_jobs_running * sizeof(*pfd));
+	for (unsigned int i = 0; i < shell_jobs_nr; i++) {
+		if (shell_jobs[i].fd < 0)
+			continue;
+		pfd[n].fd = shell_jobs[i].fd;
+		pfd[n].events = POLLIN;
+		n++;
+	}
+
+	if (poll(pfd, n, block ? -1 : 0) > 0) {
+		for (unsigned int i = 0, j = 0; i < shell_jobs_nr; i++) {
+			struct shell_job *job = &shell_jobs[i];
+			ssize_t len;
+
+			if (job->fd < 0)
+				continue;
+			if (!pfd[j++].revents)
+				continue;
+
+			len = read(job->fd, job->buf + job->len,
+				   sizeof(job->buf) - job->len);
+			if (len < 0 && errno == EINTR)
+				continue;
+			if (len > 0)
+				job->len += len;
+			if (len <= 0 || job->len == sizeof(job->buf))
+				shell_job_finish(job);
+		}
+	}
+	free(pfd);
+}
+
+/* a job whose result has not been taken yet */
+static struct shell_job *shell_job_find(uint64_t key)
+{
+	for (unsigned int i = 0; i < shell_jobs_nr; i++) {
+		struct shell_job *job = &shell_jobs[i];
+
+		if (job->key == key && (!job->done || job->result))
+			return job;
+	}
+	return NULL;
+}
+
+static void shell_jobs_add(const char *cmd)
+{
+	struct shell_job *job;
+	uint64_t key, group;
+
+	key = shell_cache_key(cmd, &group);
+	if (shell_cache_get(&shell_cache, key) || shell_job_find(key))
+		return;
+
+	shell_jobs = xrealloc(shell_jobs,
+			      (shell_jobs_nr + 1) * sizeof(*shell_jobs));
+	job = &shell_jobs[shell_jobs_nr++];
+	memset(job, 0, sizeof(*job));
+	job->cmd = xstrdup(cmd);
+	job->key = key;
+	job->group = group;
+	job->fd = -1;
+}
+
+static void shell_prefetch_load(void)
+{
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	long cpus;
+	FILE *f;
+
+	f = fopen(shell_prefetch_name, "r");
+	if (!f)
+		return;
+	while ((len = getline(&line, &size, f)) > 0) {
+		if (line[len - 1] != '\n')
+			continue;
+		line[len - 1] = 0;
+		if (*line)
+			shell_cmd_get(line)->listed = true;
+	}
+	free(line);
+	fclose(f);
+
+	for (unsigned int i = 0; i < shell_cmds_nr; i++)
+		shell_jobs_add(shell_cmds[i].cmd);
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	shell_jobs_max = cpus > 0 ? cpus : 1;
+	shell_jobs_pump(false);
+}
+
+/* list the commands run in this parse, unless the file does already */
+static void shell_prefetch_write(void)
+{
+	char tmp[PATH_MAX + 1];
+	bool changed = false;
+	FILE *f;
+	int ret;
+
+	for (unsigned int i = 0; i < shell_cmds_nr; i++)
+		if (shell_cmd_listable(shell_cmds[i].cmd) &&
+		    shell_cmds[i].listed != shell_cmds[i].requested)
+			changed = true;
+	if (!changed)
+		return;
+
+	/* replaced as a whole, for other kconfig runs in parallel */
+	snprintf(tmp, sizeof(tmp), "%s.%d.tmp", shell_prefetch_name, getpid());
+	f = fopen(tmp, "w");
+	if (!f)
+		return;
+	for (unsigned int i = 0; i < shell_cmds_nr; i++)
+		if (shell_cmds[i].requested &&
+		    shell_cmd_listable(shell_cmds[i].cmd))
+			fprintf(f, "%s\n", shell_cmds[i].cmd);
+	fflush(f);
+	ret = ferror(f);
+	fclose(f);
+	if (ret || rename(tmp, shell_prefetch_name))
+		unlink(tmp);
+}
+
+/**
+ * shell_jobs_wait - wait for the commands still run in the background
+ *
+ * Commands that have not been started yet are dropped. Then the stale lines
+ * are removed from the cache file and the commands of this parse are listed
+ * for the next one.
+ */
+void shell_jobs_wait(void)
+{
+	shell_jobs_next = shell_jobs_nr;
+	while (shell_jobs_running)
+		shell_jobs_pump(true);
+
+	for (unsigned int i = 0; i < shell_jobs_nr; i++) {
+		free(shell_jobs[i].cmd);
+		free(shell_jobs[i].result);
+	}
+	free(shell_jobs);
+	shell_jobs = NULL;
+	shell_jobs_nr = shell_jobs_next = 0;
+
+	if (shell_cache_name && shell_cache_stale) {
+		shell_cache_compact();
+		shell_cache_stale = 0;
+	}
+	if (shell_prefetch_name)
+		shell_prefetch_write();
+}
+
+static const char *shell_getenv(const char *name)
+{
+	const char *value = getenv(name);
+
+	return value && *value ? value : NULL;
+}
+
+/* returns false if neither a cache nor a prefetch file is configured */
+static bool shell_init(void)
+{
+	if (!shell_loaded) {
+		shell_loaded = true;
+		shell_cache_name = shell_getenv("KCONFIG_SHELL_CACHE");
+		shell_prefetch_name = shell_getenv("KCONFIG_SHELL_PREFETCH");
+		if (shell_cache_name)
+			shell_cache_load();
+		if (shell_prefetch_name)
+			shell_prefetch_load();
+	}
+
+	return shell_cache_name || shell_prefetch_name;
+}
+
+static char *shell_run(const char *cmd)
+{
+	FILE *p;
+	char buf[4096];
+	size_t nread;
+
+	p = popen(cmd, "r");
+	if (!p) {
+		perror(cmd);
+		exit(1);
+	}
+
+	nread = fread(buf, 1, sizeof(buf), p);
+	if (nread == sizeof(buf))
+		nread--;
+
 	if (pclose(p) == -1) {
 		perror(cmd);
 		exit(1);
 	}
 
-	return xstrdup(buf);
+	return shell_output(buf, nread);
+}
+
+static char *do_shell(int argc, char *argv[])
+{
+	struct shell_job *job;
+	const char *cached;
+	char *result;
+	uint64_t key, group;
+
+	if (!shell_init())
+		return shell_run(argv[0]);
+
+	if (shell_prefetch_name)
+		shell_cmd_get(argv[0])->requested = true;
+
+	key = shell_cache_key(argv[0], &group);
+	job = shell_job_find(key);
+	if (job && !job->started) {
+		/* not started yet, run it right here */
+		job->started = job->done = true;
+		job = NULL;
+	}
+	while (job && !job->done)
+		shell_jobs_pump(true);
+	shell_jobs_pump(false);
+
+	if (job) {
+		result = job->result;
+		job->result = NULL;
+		return result;
+	}
+
+	cached = shell_cache_get(&shell_cache, key);
+	if (cached)
+		return xstrdup(cached);
+
+	result = shell_run(argv[0]);
+	if (shell_cache_name)
+		shell_cache_store(key, group, result);
+	return result;
 }
 
 static char *do_warning_if(int argc, char *argv[])
@@ -221,6 +875,9 @@ static char *function_expand(const char *name, int argc, char *argv[])
 			pperror("too many function arguments passed to '%s'",
 				name);
 
+		/* functions have side effects or depend on the location */
+		expansion_set_impure();
+
 		return f->func(argc, argv);
 	}
 
@@ -231,6 +888,7 @@ static char *function_expand(const char *name, int argc, char *argv[])
  * Variables (and user-defined functions)
  */
 static LIST_HEAD(variable_list);
+static HASHTABLE_DEFINE(variable_hashtable, 1U << 10);
 
 struct variable {
 	char *name;
@@ -238,13 +896,63 @@ struct variable {
 	enum variable_flavor flavor;
 	int exp_count;
 	struct list_head node;
+	struct hlist_node hnode;
+	/* variable_tick when the variable was last (re)defined */
+	unsigned long version;
+	/*
+	 * The expansion without arguments of a recursive variable, valid as
+	 * long as neither the variable nor any of the variables it read have
+	 * been redefined since memo_tick. If memo_missed, the expansion also
+	 * looked up names that were not variables, and no variable may have
+	 * been created either.
+	 */
+	char *memo;
+	unsigned long memo_tick;
+	struct variable **memo_deps;
+	unsigned int memo_nr;
+	bool memo_missed;
+};
+
+/* bumped whenever a variable is defined */
+static unsigned long variable_tick;
+/* the variable_tick when the latest new variable was created */
+static unsigned long variable_created_tick;
+
+/* the variables read while expanding a recursive variable */
+struct expansion {
+	struct expansion *parent;
+	struct variable **deps;
+	unsigned int nr, size;
+	bool impure;
+	bool missed;
 };
 
+static struct expansion *cur_expansion;
+
+static void expansion_add_dep(struct expansion *e, struct variable *v)
+{
+	for (unsigned int i = 0; i < e->nr; i++)
+		if (e->deps[i] == v)
+			return;
+
+	if (e->nr == e->size) {
+		e->size = e->size ? e->size * 2 : 8;
+		e->deps = xrealloc(e->deps, e->size * sizeof(*e->deps));
+	}
+	e->deps[e->nr++] = v;
+}
+
+static void expansion_set_impure(void)
+{
+	if (cur_expansion)
+		cur_expansion->impure = true;
+}
+
 static struct variable *variable_lookup(const char *name)
 {
 	struct variable *v;
 
-	list_for_each_entry(v, &variable_list, node) {
+	hash_for_each_possible(variable_hashtable, v, hnode, hash_str(name)) {
 		if (!strcmp(name, v->name))
 			return v;
 	}
@@ -252,14 +960,46 @@ static struct variable *variable_lookup(const char *name)
 	return NULL;
 }
 
+static bool variable_memo_valid(struct variable *v)
+{
+	if (!v->memo || v->version > v->memo_tick)
+		return false;
+
+	if (v->memo_missed && variable_created_tick > v->memo_tick)
+		return false;
+
+	for (unsigned int i = 0; i < v->memo_nr; i++)
+		if (v->memo_deps[i]->version > v->memo_tick)
+			return false;
+
+	return true;
+}
+
+static void variable_memo_free(struct variable *v)
+{
+	free(v->memo);
+	free(v->memo_deps);
+	v->memo = NULL;
+	v->memo_deps = NULL;
+	v->memo_nr = 0;
+}
+
 static char *variable_expand(const char *name, int argc, char *argv[])
 {
+	struct expansion *parent = cur_expansion;
+	struct expansion e = { .parent = parent };
 	struct variable *v;
 	char *res;
 
 	v = variable_lookup(name);
-	if (!v)
+	if (!v) {
+		if (parent)
+			parent->missed = true;
 		return NULL;
+	}
+
+	if (parent)
+		expansion_add_dep(parent, v);
 
 	if (argc == 0 && v->exp_count)
 		pperror("Recursive variable '%s' references itself (eventually)",
@@ -268,14 +1008,48 @@ static char *variable_expand(const char *name, int argc, char *argv[])
 	if (v->exp_count > 1000)
 		pperror("Too deep recursive expansion");
 
-	v->exp_count++;
+	if (v->flavor != VAR_RECURSIVE)
+		return xstrdup(v->value);
 
-	if (v->flavor == VAR_RECURSIVE)
+	if (argc) {
+		v->exp_count++;
 		res = expand_string_with_args(v->value, argc, argv);
-	else
-		res = xstrdup(v->value);
+		v->exp_count--;
+		return res;
+	}
+
+	if (variable_memo_valid(v)) {
+		if (parent) {
+			for (unsigned int i = 0; i < v->memo_nr; i++)
+				expansion_add_dep(parent, v->memo_deps[i]);
+			parent->missed |= v->memo_missed;
+		}
+		return xstrdup(v->memo);
+	}
 
+	cur_expansion = &e;
+	v->exp_count++;
+	res = expand_string_with_args(v->value, argc, argv);
 	v->exp_count--;
+	cur_expansion = parent;
+
+	if (parent) {
+		for (unsigned int i = 0; i < e.nr; i++)
+			expansion_add_dep(parent, e.deps[i]);
+		parent->missed |= e.missed;
+		parent->impure |= e.impure;
+	}
+
+	variable_memo_free(v);
+	if (e.impure) {
+		free(e.deps);
+	} else {
+		v->memo = xstrdup(res);
+		v->memo_tick = variable_tick;
+		v->memo_deps = e.deps;
+		v->memo_nr = e.nr;
+		v->memo_missed = e.missed;
+	}
 
 	return res;
 }
@@ -301,10 +1075,11 @@ void variable_add(const char *name, const char *value,
 		if (flavor == VAR_APPEND)
 			flavor = VAR_RECURSIVE;
 
-		v = xmalloc(sizeof(*v));
+		v = xcalloc(1, sizeof(*v));
 		v->name = xstrdup(name);
-		v->exp_count = 0;
 		list_add_tail(&v->node, &variable_list);
+		hash_add(variable_hashtable, &v->hnode, hash_str(name));
+		variable_created_tick = variable_tick + 1;
 	}
 
 	v->flavor = flavor;
@@ -323,11 +1098,16 @@ void variable_add(const char *name, const char *value,
 	} else {
 		v->value = new_value;
 	}
+
+	/* only now, expanding a simple value may have used the memos */
+	v->version = ++variable_tick;
 }
 
 static void variable_del(struct variable *v)
 {
 	list_del(&v->node);
+	hash_del(&v->hnode);
+	variable_memo_free(v);
 	free(v->name);
 	free(v->value);
 	free(v);
@@ -504,11 +1284,10 @@ static char *__expand_string(const char **str, bool (*is_end)(char c),
 {
 	const char *in, *p;
 	char *expansion, *out;
-	size_t in_len, out_len;
+	size_t in_len, exp_len, out_len;
 
-	out = xmalloc(1);
-	*out = 0;
-	out_len = 1;
+	out = NULL;
+	out_len = 0;
 
 	p = in = *str;
 
@@ -517,10 +1296,11 @@ static char *__expand_string(const char **str, bool (*is_end)(char c),
 			in_len = p - in;
 			p++;
 			expansion = expand_dollar_with_args(&p, argc, argv);
-			out_len += in_len + strlen(expansion);
-			out = xrealloc(out, out_len);
-			strncat(out, in, in_len);
-			strcat(out, expansion);
+			exp_len = strlen(expansion);
+			out = xrealloc(out, out_len + in_len + exp_len + 1);
+			memcpy(out + out_len, in, in_len);
+			memcpy(out + out_len + in_len, expansion, exp_len);
+			out_len += in_len + exp_len;
 			free(expansion);
 			in = p;
 			continue;
@@ -533,9 +1313,9 @@ static char *__expand_string(const char **str, bool (*is_end)(char c),
 	}
 
 	in_len = p - in;
-	out_len += in_len;
-	out = xrealloc(out, out_len);
-	strncat(out, in, in_len);
+	out = xrealloc(out, out_len + in_len + 1);
+	memcpy(out + out_len, in, in_len);
+	out[out_len + in_len] = 0;
 
 	/* Advance 'str' to the end character */
 	*str = p;
@@ -13,6 +13,7 @@ void env_write_dep(struct gstr *gs);
 void variable_add(const char *name, const char *value,
 		  enum variable_flavor flavor);
 void variable_all_del(void);
+void shell_jobs_wait(void);
 char *expand_dollar(const char **str);
 char *expand_one_token(const char **str);
 
@@ -0,0 +1,1022 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Snapshot of the parsed Kconfig model.
+ *
+ * If KCONFIG_SNAPSHOT names a file, conf_parse() takes the finalized
+ * symbols, properties, expressions and menus from it instead of parsing the
+ * Kconfig files, as long as none of the files read and none of the
+ * environment variables used have changed since it was written. That is the
+ * same rule as for include/config/auto.conf.cmd, so the output of $(shell)
+ * calls is assumed to only depend on the environment. Otherwise the files
+ * are parsed and the snapshot is written anew.
+ *
+ * The file is mapped read-only. Records refer to each other by index and to
+ * strings by offset, so the snapshot does not depend on where it is mapped.
+ * Loading it rebuilds the model from the records. Prompts and file names
+ * point into the mapping, which stays in place. Help texts are copied, as
+ * zconfdump() trims them in place.
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <xalloc.h>
+#include "internal.h"
+#include "lkc.h"
+
+#define SNAPSHOT_MAGIC		"KCSNAP\0\1"
+#define SNAPSHOT_ENDIAN		0x01020304
+
+/*
+ * References in the records: 0 is NULL, anything else is the index plus one,
+ * or for strings the offset plus one. Symbol references 1 to 3 are y, m and n,
+ * the symbols in sym_array start at SNAPSHOT_SYM_FIRST.
+ */
+#define SNAPSHOT_SYM_FIRST	4
+
+enum {
+	SNAPSHOT_STRINGS,
+	SNAPSHOT_FILES,
+	SNAPSHOT_ENV,
+	SNAPSHOT_SYMBOLS,
+	SNAPSHOT_EXPRS,
+	SNAPSHOT_PROPS,
+	SNAPSHOT_MENUS,
+	SNAPSHOT_LISTS,
+	SNAPSHOT_NR
+};
+
+struct snapshot_section {
+	uint32_t off, nr;
+};
+
+struct snapshot_header {
+	char magic[8];
+	uint32_t endian;
+	uint32_t size;
+	uint32_t kconfig;		/* string: the top-level Kconfig file */
+	uint32_t autoconf_cmd;		/* string */
+	uint32_t modules_sym;		/* symbol */
+	uint32_t pad;
+	uint64_t hash;			/* of the file, with this set to 0 */
+	struct snapshot_section sec[SNAPSHOT_NR];
+};
+
+struct snapshot_file {
+	uint32_t name;
+	uint32_t size;
+	uint64_t hash;
+};
+
+struct snapshot_env {
+	uint32_t name, value;
+};
+
+struct snapshot_symbol {
+	uint32_t name, type, flags, prop;
+	uint32_t dir_dep, rev_dep, implied;
+	uint32_t menus, menus_nr;	/* menu list in SNAPSHOT_LISTS */
+};
+
+struct snapshot_expr {
+	uint32_t type, left, right;	/* children come first */
+};
+
+struct snapshot_prop {
+	uint32_t next, type, text, visible, expr, menu, filename, lineno;
+};
+
+struct snapshot_menu {				/* the first one is rootmenu */
+	uint32_t next, parent, list, sym, prompt, visibility, dep;
+	uint32_t flags, help, filename, lineno;
+	uint32_t members, members_nr;	/* symbol list in SNAPSHOT_LISTS */
+};
+
+static const size_t snapshot_rec_size[SNAPSHOT_NR] = {
+	[SNAPSHOT_STRINGS]	= 1,
+	[SNAPSHOT_FILES]	= sizeof(struct snapshot_file),
+	[SNAPSHOT_ENV]		= sizeof(struct snapshot_env),
+	[SNAPSHOT_SYMBOLS]	= sizeof(struct snapshot_symbol),
+	[SNAPSHOT_EXPRS]	= sizeof(struct snapshot_expr),
+	[SNAPSHOT_PROPS]	= sizeof(struct snapshot_prop),
+	[SNAPSHOT_MENUS]	= sizeof(struct snapshot_menu),
+	[SNAPSHOT_LISTS]	= sizeof(uint32_t),
+};
+
+/* the Kconfig files and environment variables the parse depended on */
+static const char **snapshot_files;
+static unsigned int snapshot_files_nr, snapshot_files_size;
+
+static struct snapshot_env_dep {
+	char *name, *value;
+} *snapshot_env;
+static unsigned int snapshot_env_nr, snapshot_env_size;
+
+static const char *snapshot_name(void)
+{
+	const char *name = getenv("KCONFIG_SNAPSHOT");
+
+	return name && *name ? name : NULL;
+}
+
+/* called by file_lookup() for every new file */
+void snapshot_add_file(const char *name)
+{
+	if (snapshot_files_nr == snapshot_files_size) {
+		snapshot_files_size = snapshot_files_size ?
+				      snapshot_files_size * 2 : 256;
+		snapshot_files = xrealloc(snapshot_files, snapshot_files_size *
+					  sizeof(*snapshot_files));
+	}
+	snapshot_files[snapshot_files_nr++] = name;
+}
+
+/* called by env_write_dep() for every environment variable used */
+void snapshot_add_env(const char *name, const char *value)
+{
+	if (snapshot_env_nr == snapshot_env_size) {
+		snapshot_env_size = snapshot_env_size ?
+				    snapshot_env_size * 2 : 16;
+		snapshot_env = xrealloc(snapshot_env, snapshot_env_size *
+					sizeof(*snapshot_env));
+	}
+	snapshot_env[snapshot_env_nr].name = xstrdup(name);
+	snapshot_env[snapshot_env_nr].value = xstrdup(value);
+	snapshot_env_nr++;
+}
+
+#define SNAPSHOT_HASH_INIT	0xcbf29ce484222325ULL
+
+/* FNV-1a */
+static uint64_t snapshot_hash_buf(uint64_t h, const void *p, size_t len)
+{
+	const unsigned char *c = p;
+
+	for (size_t i = 0; i < len; i++)
+		h = (h ^ c[i]) * 0x100000001b3ULL;
+	return h;
+}
+
+/* hash the contents of a Kconfig file, false if it cannot be read */
+static bool snapshot_hash_file(const char *name, uint64_t *hash,
+			       uint32_t *size)
+{
+	char buf[65536];
+	uint64_t h = SNAPSHOT_HASH_INIT;
+	uint64_t total = 0;
+	size_t len;
+	FILE *f;
+
+	f = zconf_fopen(name);
+	if (!f)
+		return false;
+
+	while ((len = fread(buf, 1, sizeof(buf), f)) > 0) {
+		h = snapshot_hash_buf(h, buf, len);
+		total += len;
+	}
+	if (ferror(f) || total > UINT32_MAX) {
+		fclose(f);
+		return false;
+	}
+	fclose(f);
+
+	*hash = h;
+	*size = total;
+	return true;
+}
+
+/*
+ * Writing
+ */
+
+struct snapshot_buf {
+	char *p;
+	size_t len, size;
+};
+
+/* maps pointers to references */
+struct snapshot_map {
+	const void **key;
+	uint32_t *ref;
+	unsigned int size, nr;
+};
+
+struct snapshot_writer {
+	struct snapshot_buf sec[SNAPSHOT_NR];
+	struct snapshot_map strings, exprs, props, menus;
+
+	/* the properties in the order they are numbered */
+	struct property **prop_list;
+
+	/* set if something refers to a menu outside the menu tree */
+	bool incomplete;
+};
+
+static void *snapshot_buf_add(struct snapshot_buf *b, size_t len)
+{
+	void *p;
+
+	if (b->len + len > b->size) {
+		while (b->len + len > b->size)
+			b->size = b->size ? b->size * 2 : 4096;
+		b->p = xrealloc(b->p, b->size);
+	}
+	p = b->p + b->len;
+	memset(p, 0, len);
+	b->len += len;
+	return p;
+}
+
+static unsigned int snapshot_hash(const void *key)
+{
+	return ((uintptr_t)key * 0x9e3779b97f4a7c15ULL) >> 32;
+}
+
+static uint32_t snapshot_map_get(struct snapshot_map *map, const void *key)
+{
+	unsigned int mask = map->size - 1;
+
+	if (!map->size)
+		return 0;
+	for (unsigned int i = snapshot_hash(key) & mask; map->key[i];
+	     i = (i + 1) & mask)
+		if (map->key[i] == key)
+			return map->ref[i];
+	return 0;
+}
+
+static void snapshot_map_insert(struct snapshot_map *map, const void *key,
+				uint32_t ref)
+{
+	unsigned int mask = map->size - 1;
+	unsigned int i;
+
+	for (i = snapshot_hash(key) & mask; map->key[i]; i = (i + 1) & mask)
+		;
+	map->key[i] = key;
+	map->ref[i] = ref;
+}
+
+static void snapshot_map_set(struct snapshot_map *map, const void *key,
+			     uint32_t ref)
+{
+	if ((map->nr + 1) * 2 > map->size) {
+		struct snapshot_map old = *map;
+
+		map->size = old.size ? old.size * 2 : 1024;
+		map->key = xcalloc(map->size, sizeof(*map->key));
+		map->ref = xcalloc(map->size, sizeof(*map->ref));
+		for (unsigned int i = 0; i < old.size; i++)
+			if (old.key[i])
+				snapshot_map_insert(map, old.key[i],
+						    old.ref[i]);
+		free(old.key);
+		free(old.ref);
+	}
+	snapshot_map_insert(map, key, ref);
+	map->nr++;
+}
+
+static void snapshot_map_free(struct snapshot_map *map)
+{
+	free(map->key);
+	free(map->ref);
+}
+
+/* strings are shared by pointer, file names are interned by file_lookup() */
+static uint32_t snapshot_put_string(struct snapshot_writer *w, const char *s)
+{
+	struct snapshot_buf *b = &w->sec[SNAPSHOT_STRINGS];
+	uint32_t ref;
+	size_t len;
+
+	if (!s)
+		return 0;
+	ref = snapshot_map_get(&w->strings, s);
+	if (ref)
+		return ref;
+
+	len = strlen(s) + 1;
+	ref = b->len + 1;
+	memcpy(snapshot_buf_add(b, len), s, len);
+	snapshot_map_set(&w->strings, s, ref);
+	return ref;
+}
+
+static uint32_t snapshot_sym_ref(struct symbol *sym)
+{
+	if (!sym)
+		return 0;
+	if (sym == &symbol_yes)
+		return 1;
+	if (sym == &symbol_mod)
+		return 2;
+	if (sym == &symbol_no)
+		return 3;
+	return sym->id + SNAPSHOT_SYM_FIRST;
+}
+
+static uint32_t snapshot_put_expr(struct snapshot_writer *w, struct expr *e)
+{
+	struct snapshot_buf *b = &w->sec[SNAPSHOT_EXPRS];
+	struct snapshot_expr *rec;
+	uint32_t ref, left, right;
+
+	if (!e)
+		return 0;
+	ref = snapshot_map_get(&w->exprs, e);
+	if (ref)
+		return ref;
+
+	switch (e->type) {
+	case E_OR:
+	case E_AND:
+		left = snapshot_put_expr(w, e->left.expr);
+		right = snapshot_put_expr(w, e->right.expr);
+		break;
+	case E_NOT:
+		left = snapshot_put_expr(w, e->left.expr);
+		right = 0;
+		break;
+	default:
+		left = snapshot_sym_ref(e->left.sym);
+		right = snapshot_sym_ref(e->right.sym);
+		break;
+	}
+
+	rec = snapshot_buf_add(b, sizeof(*rec));
+	rec->type = e->type;
+	rec->left = left;
+	rec->right = right;
+	ref = b->len / sizeof(*rec);
+	snapshot_map_set(&w->exprs, e, ref);
+	return ref;
+}
+
+static uint32_t snapshot_put_list(struct snapshot_writer *w, uint32_t ref)
+{
+	struct snapshot_buf *b = &w->sec[SNAPSHOT_LISTS];
+	uint32_t pos = b->len / sizeof(uint32_t);
+
+	*(uint32_t *)snapshot_buf_add(b, sizeof(uint32_t)) = ref;
+	return pos;
+}
+
+static void snapshot_number_prop(struct snapshot_writer *w,
+				 struct property *prop)
+{
+	unsigned int nr = w->props.nr;
+
+	if (!prop || snapshot_map_get(&w->props, prop))
+		return;
+	if (!(nr & (nr - 1)))
+		w->prop_list = xrealloc(w->prop_list, (nr ? nr * 2 : 1) *
+					sizeof(*w->prop_list));
+	w->prop_list[nr] = prop;
+	snapshot_map_set(&w->props, prop, nr + 1);
+}
+
+/* number the menus and properties first, they refer to each other */
+static void snapshot_number(struct snapshot_writer *w)
+{
+	struct symbol *sym;
+	struct menu *menu;
+
+	snapshot_map_set(&w->menus, &rootmenu, 1);
+	menu_for_each_entry(menu)
+		snapshot_map_set(&w->menus, menu, w->menus.nr + 1);
+
+	for_all_symbols(sym)
+		for (struct property *prop = sym->prop; prop; prop = prop->next)
+			snapshot_number_prop(w, prop);
+	snapshot_number_prop(w, rootmenu.prompt);
+	menu_for_each_entry(menu)
+		snapshot_number_prop(w, menu->prompt);
+}
+
+static uint32_t snapshot_menu_ref(struct snapshot_writer *w,
+				  struct menu *menu)
+{
+	uint32_t ref = snapshot_map_get(&w->menus, menu);
+
+	if (menu && !ref)
+		w->incomplete = true;
+	return ref;
+}
+
+static void snapshot_put_prop(struct snapshot_writer *w, struct property *prop)
+{
+	struct snapshot_prop *rec;
+
+	rec = snapshot_buf_add(&w->sec[SNAPSHOT_PROPS], sizeof(*rec));
+	rec->next = snapshot_map_get(&w->props, prop->next);
+	rec->type = prop->type;
+	rec->text = snapshot_put_string(w, prop->text);
+	rec->visible = snapshot_put_expr(w, prop->visible.expr);
+	rec->expr = snapshot_put_expr(w, prop->expr);
+	rec->menu = snapshot_menu_ref(w, prop->menu);
+	rec->filename = snapshot_put_string(w, prop->filename);
+	rec->lineno = prop->lineno;
+}
+
+static void snapshot_put_menu(struct snapshot_writer *w, struct menu *menu)
+{
+	struct snapshot_menu *rec;
+	struct symbol *sym;
+	uint32_t members, members_nr = 0;
+
+	members = w->sec[SNAPSHOT_LISTS].len / sizeof(uint32_t);
+	if (menu->sym && sym_is_choice(menu->sym)) {
+		list_for_each_entry(sym, &menu->choice_members, choice_link) {
+			snapshot_put_list(w, snapshot_sym_ref(sym));
+			members_nr++;
+		}
+	}
+
+	rec = snapshot_buf_add(&w->sec[SNAPSHOT_MENUS], sizeof(*rec));
+	rec->next = snapshot_menu_ref(w, menu->next);
+	rec->parent = snapshot_menu_ref(w, menu->parent);
+	rec->list = snapshot_menu_ref(w, menu->list);
+	rec->sym = snapshot_sym_ref(menu->sym);
+	rec->prompt = snapshot_map_get(&w->props, menu->prompt);
+	rec->visibility = snapshot_put_expr(w, menu->visibility);
+	rec->dep = snapshot_put_expr(w, menu->dep);
+	rec->flags = menu->flags;
+	rec->help = snapshot_put_string(w, menu->help);
+	rec->filename = snapshot_put_string(w, menu->filename);
+	rec->lineno = menu->lineno;
+	rec->members = members;
+	rec->members_nr = members_nr;
+}
+
+static void snapshot_put_symbol(struct snapshot_writer *w, struct symbol *sym)
+{
+	struct snapshot_symbol *rec;
+	struct menu *menu;
+	uint32_t menus, menus_nr = 0;
+
+	menus = w->sec[SNAPSHOT_LISTS].len / sizeof(uint32_t);
+	list_for_each_entry(menu, &sym->menus, link) {
+		snapshot_put_list(w, snapshot_menu_ref(w, menu));
+		menus_nr++;
+	}
+
+	rec = snapshot_buf_add(&w->sec[SNAPSHOT_SYMBOLS], sizeof(*rec));
+	rec->name = snapshot_put_string(w, sym->name);
+	rec->type = sym->type;
+	/* values are calculated again */
+	rec->flags = sym->flags & ~SYMBOL_VALID;
+	rec->prop = snapshot_map_get(&w->props, sym->prop);
+	rec->dir_dep = snapshot_put_expr(w, sym->dir_dep.expr);
+	rec->rev_dep = snapshot_put_expr(w, sym->rev_dep.expr);
+	rec->implied = snapshot_put_expr(w, sym->implied.expr);
+	rec->menus = menus;
+	rec->menus_nr = menus_nr;
+}
+
+static bool snapshot_write(const char *file, struct snapshot_writer *w,
+			   struct snapshot_header *hdr)
+{
+	char tmpname[PATH_MAX + 1];
+	static const char zero[8];
+	size_t off = sizeof(*hdr);
+	FILE *out;
+	int err;
+
+	for (int i = 0; i < SNAPSHOT_NR; i++) {
+		off = (off + 7) & ~(size_t)7;
+		hdr->sec[i].off = off;
+		hdr->sec[i].nr = w->sec[i].len / snapshot_rec_size[i];
+		off += w->sec[i].len;
+	}
+	if (off > UINT32_MAX)
+		return false;
+	hdr->size = off;
+
+	hdr->hash = snapshot_hash_buf(SNAPSHOT_HASH_INIT, hdr, sizeof(*hdr));
+	off = sizeof(*hdr);
+	for (int i = 0; i < SNAPSHOT_NR; i++) {
+		hdr->hash = snapshot_hash_buf(hdr->hash, zero,
+					      hdr->sec[i].off - off);
+		hdr->hash = snapshot_hash_buf(hdr->hash, w->sec[i].p,
+					      w->sec[i].len);
+		off = hdr->sec[i].off + w->sec[i].len;
+	}
+
+	snprintf(tmpname, sizeof(tmpname), "%s.%d.tmp", file, (int)getpid());
+	out = fopen(tmpname, "w");
+	if (!out)
+		return false;
+
+	fwrite(hdr, sizeof(*hdr), 1, out);
+	off = sizeof(*hdr);
+	for (int i = 0; i < SNAPSHOT_NR; i++) {
+		fwrite(zero, 1, hdr->sec[i].off - off, out);
+		if (w->sec[i].len)
+			fwrite(w->sec[i].p, 1, w->sec[i].len, out);
+		off = hdr->sec[i].off + w->sec[i].len;
+	}
+
+	err = ferror(out);
+	if (fclose(out) || err || rename(tmpname, file)) {
+		unlink(tmpname);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * snapshot_save - write the model just parsed to the snapshot file
+ * @name: the top-level Kconfig file
+ *
+ * Does nothing if KCONFIG_SNAPSHOT is not set. Failing to write the snapshot
+ * is not an error, the next run just parses the files again.
+ */
+void snapshot_save(const char *name)
+{
+	struct snapshot_writer w;
+	struct snapshot_header hdr;
+	const char *file = snapshot_name();
+	struct symbol *sym;
+	struct menu *menu;
+
+	if (!file)
+		return;
+
+	memset(&w, 0, sizeof(w));
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, SNAPSHOT_MAGIC, sizeof(hdr.magic));
+	hdr.endian = SNAPSHOT_ENDIAN;
+
+	for (unsigned int i = 0; i < snapshot_files_nr; i++) {
+		struct snapshot_file *rec;
+
+		rec = snapshot_buf_add(&w.sec[SNAPSHOT_FILES], sizeof(*rec));
+		rec->name = snapshot_put_string(&w, snapshot_files[i]);
+		if (!snapshot_hash_file(snapshot_files[i], &rec->hash,
+					&rec->size))
+			goto out;
+	}
+	for (unsigned int i = 0; i < snapshot_env_nr; i++) {
+		struct snapshot_env *rec;
+
+		rec = snapshot_buf_add(&w.sec[SNAPSHOT_ENV], sizeof(*rec));
+		rec->name = snapshot_put_string(&w, snapshot_env[i].name);
+		rec->value = snapshot_put_string(&w, snapshot_env[i].value);
+	}
+
+	hdr.kconfig = snapshot_put_string(&w, name);
+	hdr.autoconf_cmd = snapshot_put_string(&w, str_get(&autoconf_cmd));
+	hdr.modules_sym = snapshot_sym_ref(modules_sym);
+
+	snapshot_number(&w);
+	for (unsigned int i = 0; i < w.props.nr; i++)
+		snapshot_put_prop(&w, w.prop_list[i]);
+
+	snapshot_put_menu(&w, &rootmenu);
+	menu_for_each_entry(menu)
+		snapshot_put_menu(&w, menu);
+	for_all_symbols(sym)
+		snapshot_put_symbol(&w, sym);
+
+	if (w.incomplete || !snapshot_write(file, &w, &hdr))
+		fprintf(stderr, "%s: failed to write the Kconfig snapshot\n",
+			file);
+out:
+	for (int i = 0; i < SNAPSHOT_NR; i++)
+		free(w.sec[i].p);
+	snapshot_map_free(&w.strings);
+	snapshot_map_free(&w.exprs);
+	snapshot_map_free(&w.props);
+	snapshot_map_free(&w.menus);
+	free(w.prop_list);
+}
+
+/*
+ * Loading
+ */
+
+struct snapshot {
+	const char *base;
+	size_t size;
+	const struct snapshot_header *hdr;
+	const char *strings;
+	const struct snapshot_file *files;
+	const struct snapshot_env *env;
+	const struct snapshot_symbol *syms;
+	const struct snapshot_expr *exprs;
+	const struct snapshot_prop *props;
+	const struct snapshot_menu *menus;
+	const uint32_t *lists;
+};
+
+static uint32_t snapshot_nr(const struct snapshot *s, int sec)
+{
+	return s->hdr->sec[sec].nr;
+}
+
+static const char *snapshot_str(const struct snapshot *s, uint32_t ref)
+{
+	return ref ? s->strings + ref - 1 : NULL;
+}
+
+static bool snapshot_check_str(const struct snapshot *s, uint32_t ref)
+{
+	return ref <= snapshot_nr(s, SNAPSHOT_STRINGS);
+}
+
+static bool snapshot_check_sym(const struct snapshot *s, uint32_t ref)
+{
+	return ref < snapshot_nr(s, SNAPSHOT_SYMBOLS) + SNAPSHOT_SYM_FIRST;
+}
+
+static bool snapshot_check_ref(const struct snapshot *s, int sec, uint32_t ref)
+{
+	return ref <= snapshot_nr(s, sec);
+}
+
+static bool snapshot_check_list(const struct snapshot *s, uint32_t pos,
+				uint32_t nr)
+{
+	return (uint64_t)pos + nr <= snapshot_nr(s, SNAPSHOT_LISTS);
+}
+
+/* check the layout, and that all references are in range */
+static bool snapshot_check(struct snapshot *s)
+{
+	const struct snapshot_header *hdr = s->hdr;
+	uint32_t nr_strings, nr_exprs;
+
+	struct snapshot_header copy;
+
+	if (s->size < sizeof(*hdr) ||
+	    memcmp(hdr->magic, SNAPSHOT_MAGIC, sizeof(hdr->magic)) ||
+	    hdr->endian != SNAPSHOT_ENDIAN || hdr->size != s->size)
+		return false;
+
+	/* catches damage that still leaves all references in range */
+	copy = *hdr;
+	copy.hash = 0;
+	if (snapshot_hash_buf(snapshot_hash_buf(SNAPSHOT_HASH_INIT, &copy,
+						sizeof(copy)),
+			      s->base + sizeof(*hdr),
+			      s->size - sizeof(*hdr)) != hdr->hash)
+		return false;
+
+	for (int i = 0; i < SNAPSHOT_NR; i++) {
+		uint64_t end = hdr->sec[i].off +
+			       (uint64_t)hdr->sec[i].nr * snapshot_rec_size[i];
+
+		if (hdr->sec[i].off % 8 || end > s->size)
+			return false;
+	}
+
+	s->strings = s->base + hdr->sec[SNAPSHOT_STRINGS].off;
+	s->files = (const void *)(s->base + hdr->sec[SNAPSHOT_FILES].off);
+	s->env = (const void *)(s->base + hdr->sec[SNAPSHOT_ENV].off);
+	s->syms = (const void *)(s->base + hdr->sec[SNAPSHOT_SYMBOLS].off);
+	s->exprs = (const void *)(s->base + hdr->sec[SNAPSHOT_EXPRS].off);
+	s->props = (const void *)(s->base + hdr->sec[SNAPSHOT_PROPS].off);
+	s->menus = (const void *)(s->base + hdr->sec[SNAPSHOT_MENUS].off);
+	s->lists = (const void *)(s->base + hdr->sec[SNAPSHOT_LISTS].off);
+
+	/* every string ends before the end of the section */
+	nr_strings = snapshot_nr(s, SNAPSHOT_STRINGS);
+	if (nr_strings && s->strings[nr_strings - 1])
+		return false;
+
+	if (!hdr->kconfig || !snapshot_check_str(s, hdr->kconfig) ||
+	    !hdr->autoconf_cmd || !snapshot_check_str(s, hdr->autoconf_cmd) ||
+	    !hdr->modules_sym || !snapshot_check_sym(s, hdr->modules_sym))
+		return false;
+
+	for (uint32_t i = 0; i < snapshot_nr(s, SNAPSHOT_FILES); i++)
+		if (!s->files[i].name ||
+		    !snapshot_check_str(s, s->files[i].name))
+			return false;
+
+	for (uint32_t i = 0; i < snapshot_nr(s, SNAPSHOT_ENV); i++)
+		if (!s->env[i].name || !snapshot_check_str(s, s->env[i].name) ||
+		    !s->env[i].value || !snapshot_check_str(s, s->env[i].value))
+			return false;
+
+	nr_exprs = snapshot_nr(s, SNAPSHOT_EXPRS);
+	for (uint32_t i = 0; i < nr_exprs; i++) {
+		const struct snapshot_expr *rec = &s->exprs[i];
+
+		/* children are stored before their parents */
+		switch (rec->type) {
+		case E_OR:
+		case E_AND:
+			if (!rec->left || rec->left > i ||
+			    !rec->right || rec->right > i)
+				return false;
+			break;
+		case E_NOT:
+			if (!rec->left || rec->left > i || rec->right)
+				return false;
+			break;
+		case E_SYMBOL:
+			if (!rec->left || !snapshot_check_sym(s, rec->left) ||
+			    rec->right)
+				return false;
+			break;
+		case E_EQUAL:
+		case E_UNEQUAL:
+		case E_LTH:
+		case E_LEQ:
+		case E_GTH:
+		case E_GEQ:
+		case E_RANGE:
+			if (!rec->left || !snapshot_check_sym(s, rec->left) ||
+			    !rec->right || !snapshot_check_sym(s, rec->right))
+				return false;
+			break;
+		default:
+			return false;
+		}
+	}
+
+	for (uint32_t i = 0; i < snapshot_nr(s, SNAPSHOT_PROPS); i++) {
+		const struct snapshot_prop *rec = &s->props[i];
+
+		if (!snapshot_check_ref(s, SNAPSHOT_PROPS, rec->next) ||
+		    rec->type > P_RANGE ||
+		    !snapshot_check_str(s, rec->text) ||
+		    !snapshot_check_ref(s, SNAPSHOT_EXPRS, rec->visible) ||
+		    !snapshot_check_ref(s, SNAPSHOT_EXPRS, rec->expr) ||
+		    !snapshot_check_ref(s, SNAPSHOT_MENUS, rec->menu) ||
+		    !snapshot_check_str(s, rec->filename))
+			return false;
+	}
+
+	/* there is at least rootmenu and its prompt */
+	if (!snapshot_nr(s, SNAPSHOT_MENUS) || !snapshot_nr(s, SNAPSHOT_PROPS))
+		return false;
+	for (uint32_t i = 0; i < snapshot_nr(s, SNAPSHOT_MENUS); i++) {
+		const struct snapshot_menu *rec = &s->menus[i];
+
+		if (!snapshot_check_ref(s, SNAPSHOT_MENUS, rec->next) ||
+		    !snapshot_check_ref(s, SNAPSHOT_MENUS, rec->parent) ||
+		    !snapshot_check_ref(s, SNAPSHOT_MENUS, rec->list) ||
+		    !snapshot_check_sym(s, rec->sym) ||
+		    (rec->sym && rec->sym < SNAPSHOT_SYM_FIRST) ||
+		    !snapshot_check_ref(s, SNAPSHOT_PROPS, rec->prompt) ||
+		    !snapshot_check_ref(s, SNAPSHOT_EXPRS, rec->visibility) ||
+		    !snapshot_check_ref(s, SNAPSHOT_EXPRS, rec->dep) ||
+		    !snapshot_check_str(s, rec->help) ||
+		    !snapshot_check_str(s, rec->filename) ||
+		    !snapshot_check_list(s, rec->members, rec->members_nr))
+			return false;
+
+		for (uint32_t j = 0; j < rec->members_nr; j++) {
+			uint32_t ref = s->lists[rec->members + j];
+
+			if (ref < SNAPSHOT_SYM_FIRST || !snapshot_check_sym(s, ref))
+				return false;
+		}
+	}
+
+	for (uint32_t i = 0; i < snapshot_nr(s, SNAPSHOT_SYMBOLS); i++) {
+		const struct snapshot_symbol *rec = &s->syms[i];
+
+		if (!snapshot_check_str(s, rec->name) ||
+		    rec->type > S_STRING ||
+		    !snapshot_check_ref(s, SNAPSHOT_PROPS, rec->prop) ||
+		    !snapshot_check_ref(s, SNAPSHOT_EXPRS, rec->dir_dep) ||
+		    !snapshot_check_ref(s, SNAPSHOT_EXPRS, rec->rev_dep) ||
+		    !snapshot_check_ref(s, SNAPSHOT_EXPRS, rec->implied) ||
+		    !snapshot_check_list(s, rec->menus, rec->menus_nr))
+			return false;
+
+		for (uint32_t j = 0; j < rec->menus_nr; j++) {
+			uint32_t ref = s->lists[rec->menus + j];
+
+			if (!ref || !snapshot_check_ref(s, SNAPSHOT_MENUS, ref))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/* has anything the parse depended on changed? */
+static bool snapshot_is_current(const struct snapshot *s, const char *name)
+{
+	const struct snapshot_header *hdr = s->hdr;
+
+	if (strcmp(snapshot_str(s, hdr->kconfig), name))
+		return false;
+
+	for (uint32_t i = 0; i < snapshot_nr(s, SNAPSHOT_ENV); i++) {
+		const char *value = getenv(snapshot_str(s, s->env[i].name));
+
+		if (!value || strcmp(value, snapshot_str(s, s->env[i].value)))
+			return false;
+	}
+
+	for (uint32_t i = 0; i < snapshot_nr(s, SNAPSHOT_FILES); i++) {
+		uint64_t hash;
+		uint32_t size;
+
+		if (!snapshot_hash_file(snapshot_str(s, s->files[i].name),
+					&hash, &size) ||
+		    hash != s->files[i].hash || size != s->files[i].size)
+			return false;
+	}
+
+	return true;
+}
+
+static void snapshot_build(const struct snapshot *s, const char *file)
+{
+	uint32_t nr_syms = snapshot_nr(s, SNAPSHOT_SYMBOLS);
+	uint32_t nr_exprs = snapshot_nr(s, SNAPSHOT_EXPRS);
+	uint32_t nr_props = snapshot_nr(s, SNAPSHOT_PROPS);
+	uint32_t nr_menus = snapshot_nr(s, SNAPSHOT_MENUS);
+	struct symbol **syms;
+	struct expr **exprs;
+	struct property *props;
+	struct menu **menus, *menu_block;
+
+	_menu_init();
+
+	for (uint32_t i = 0; i < snapshot_nr(s, SNAPSHOT_FILES); i++)
+		file_lookup(snapshot_str(s, s->files[i].name));
+	str_free(&autoconf_cmd);
+	autoconf_cmd = str_new();
+	str_append(&autoconf_cmd, snapshot_str(s, s->hdr->autoconf_cmd));
+
+	syms = xmalloc((nr_syms + SNAPSHOT_SYM_FIRST) * sizeof(*syms));
+	syms[0] = NULL;
+	syms[1] = &symbol_yes;
+	syms[2] = &symbol_mod;
+	syms[3] = &symbol_no;
+	for (uint32_t i = 0; i < nr_syms; i++) {
+		const struct snapshot_symbol *rec = &s->syms[i];
+		struct symbol *sym;
+
+		sym = sym_lookup(snapshot_str(s, rec->name),
+				 rec->flags & SYMBOL_CONST);
+		if (sym->id != i || sym == syms[1] || sym == syms[2] ||
+		    sym == syms[3]) {
+			fprintf(stderr, "%s: broken Kconfig snapshot\n", file);
+			exit(1);
+		}
+		syms[i + SNAPSHOT_SYM_FIRST] = sym;
+	}
+
+	exprs = xmalloc((nr_exprs + 1) * sizeof(*exprs));
+	exprs[0] = NULL;
+	for (uint32_t i = 0; i < nr_exprs; i++) {
+		const struct snapshot_expr *rec = &s->exprs[i];
+		struct expr *e;
+
+		switch (rec->type) {
+		case E_OR:
+		case E_AND:
+			e = expr_alloc_two(rec->type, exprs[rec->left],
+					   exprs[rec->right]);
+			break;
+		case E_NOT:
+			e = expr_alloc_one(E_NOT, exprs[rec->left]);
+			break;
+		case E_SYMBOL:
+			e = expr_alloc_symbol(syms[rec->left]);
+			break;
+		default:
+			e = expr_alloc_comp(rec->type, syms[rec->left],
+					    syms[rec->right]);
+			break;
+		}
+		exprs[i + 1] = e;
+	}
+
+	props = xcalloc(nr_props, sizeof(*props));
+	/* the first entry is unused, that one is rootmenu */
+	menu_block = xcalloc(nr_menus, sizeof(*menu_block));
+	menus = xmalloc((nr_menus + 1) * sizeof(*menus));
+	menus[0] = NULL;
+	menus[1] = &rootmenu;
+	for (uint32_t i = 1; i < nr_menus; i++)
+		menus[i + 1] = &menu_block[i];
+
+	for (uint32_t i = 0; i < nr_props; i++) {
+		const struct snapshot_prop *rec = &s->props[i];
+		struct property *prop = &props[i];
+
+		prop->next = rec->next ? &props[rec->next - 1] : NULL;
+		prop->type = rec->type;
+		prop->text = snapshot_str(s, rec->text);
+		prop->visible.expr = exprs[rec->visible];
+		prop->expr = exprs[rec->expr];
+		prop->menu = menus[rec->menu];
+		prop->filename = snapshot_str(s, rec->filename);
+		prop->lineno = rec->lineno;
+	}
+
+	for (uint32_t i = 0; i < nr_menus; i++) {
+		const struct snapshot_menu *rec = &s->menus[i];
+		struct menu *menu = menus[i + 1];
+		struct symbol *sym = syms[rec->sym];
+
+		memset(menu, 0, sizeof(*menu));
+		menu->next = menus[rec->next];
+		menu->parent = menus[rec->parent];
+		menu->list = menus[rec->list];
+		menu->sym = sym;
+		menu->prompt = rec->prompt ? &props[rec->prompt - 1] : NULL;
+		menu->visibility = exprs[rec->visibility];
+		menu->dep = exprs[rec->dep];
+		menu->flags = rec->flags;
+		if (rec->help)
+			menu->help = xstrdup(snapshot_str(s, rec->help));
+		menu->filename = snapshot_str(s, rec->filename);
+		menu->lineno = rec->lineno;
+
+		if (!sym || !sym_is_choice(sym))
+			continue;
+		INIT_LIST_HEAD(&menu->choice_members);
+		for (uint32_t j = 0; j < rec->members_nr; j++)
+			list_add_tail(&syms[s->lists[rec->members + j]]->choice_link,
+				      &menu->choice_members);
+	}
+
+	for (uint32_t i = 0; i < nr_syms; i++) {
+		const struct snapshot_symbol *rec = &s->syms[i];
+		struct symbol *sym = syms[i + SNAPSHOT_SYM_FIRST];
+
+		sym->type = rec->type;
+		sym->flags = rec->flags;
+		sym->prop = rec->prop ? &props[rec->prop - 1] : NULL;
+		sym->dir_dep.expr = exprs[rec->dir_dep];
+		sym->rev_dep.expr = exprs[rec->rev_dep];
+		sym->implied.expr = exprs[rec->implied];
+		for (uint32_t j = 0; j < rec->menus_nr; j++)
+			list_add_tail(&menus[s->lists[rec->menus + j]]->link,
+				      &sym->menus);
+	}
+
+	modules_sym = syms[s->hdr->modules_sym];
+
+	free(syms);
+	free(exprs);
+	free(menus);
+
+	/* the rest of what menu_finalize() does */
+	sym_build_rdeps();
+	expr_compile_all();
+}
+
+/**
+ * snapshot_load - take the model from the snapshot file
+ * @name: the top-level Kconfig file
+ *
+ * Return: true if the model was loaded, false if the Kconfig files have to
+ * be parsed. The snapshot stays mapped, the prompts and help texts point
+ * into it.
+ */
+bool snapshot_load(const char *name)
+{
+	const char *file = snapshot_name();
+	struct snapshot s;
+	struct stat st;
+	void *base;
+	int fd;
+
+	/* the symbols have to get the same ids as when it was written */
+	if (!file || sym_array_nr)
+		return false;
+
+	fd = open(file, O_RDONLY);
+	if (fd < 0)
+		return false;
+	if (fstat(fd, &st) || st.st_size < (off_t)sizeof(*s.hdr)) {
+		close(fd);
+		return false;
+	}
+	base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED)
+		return false;
+
+	memset(&s, 0, sizeof(s));
+	s.base = base;
+	s.size = st.st_size;
+	s.hdr = base;
+
+	if (!snapshot_check(&s) || !snapshot_is_current(&s, name)) {
+		munmap(base, st.st_size);
+		return false;
+	}
+
+	snapshot_build(&s, file);
+	return true;
+}
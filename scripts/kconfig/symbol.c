@@ -189,12 +189,23 @@ static void sym_validate_range(struct symbol *sym)
 	sym->curr.val = range_sym->curr.val;
 }
 
+static void (*sym_changed_callback)(struct symbol *sym);
+
+void sym_set_changed_callback(void (*fn)(struct symbol *sym))
+{
+	sym_changed_callback = fn;
+}
+
 static void sym_set_changed(struct symbol *sym)
 {
 	struct menu *menu;
 
 	list_for_each_entry(menu, &sym->menus, link)
 		menu->flags |= MENU_CHANGED;
+	menu_invalidate_visibility();
+
+	if (sym_changed_callback)
+		sym_changed_callback(sym);
 }
 
 static void sym_set_all_changed(void)
@@ -359,10 +370,11 @@ struct symbol *sym_calc_choice(struct menu *choice)
 
 		val = sym == res ? yes : no;
 
-		if (sym->curr.tri != val)
+		if (sym->curr.tri != val) {
+			sym->curr.tri = val;
 			sym_set_changed(sym);
+		}
 
-		sym->curr.tri = val;
 		sym->flags |= SYMBOL_VALID | SYMBOL_WRITE;
 	}
 
@@ -533,10 +545,209 @@ void sym_clear_all_valid(void)
 	for_all_symbols(sym)
 		sym->flags &= ~SYMBOL_VALID;
 	expr_invalidate_all();
+	menu_invalidate_visibility();
 	conf_set_changed(true);
 	sym_calc_value(modules_sym);
 }
 
+static bool rdeps_built;
+static unsigned int dep_order_next;
+
+static void sym_add_rdep(struct symbol *dep, struct symbol *sym)
+{
+	if (!dep || dep == sym || dep->flags & SYMBOL_CONST)
+		return;
+
+	/* the dependencies of a symbol are added in a row */
+	if (dep->rdeps_nr && dep->rdeps[dep->rdeps_nr - 1] == sym)
+		return;
+
+	dep->rdeps = xrealloc(dep->rdeps,
+			      (dep->rdeps_nr + 1) * sizeof(*dep->rdeps));
+	dep->rdeps[dep->rdeps_nr++] = sym;
+}
+
+static void expr_add_rdeps(struct expr *e, struct symbol *sym)
+{
+	if (!e)
+		return;
+
+	switch (e->type) {
+	case E_SYMBOL:
+		sym_add_rdep(e->left.sym, sym);
+		break;
+	case E_NOT:
+		expr_add_rdeps(e->left.expr, sym);
+		break;
+	case E_AND:
+	case E_OR:
+		expr_add_rdeps(e->left.expr, sym);
+		expr_add_rdeps(e->right.expr, sym);
+		break;
+	case E_EQUAL:
+	case E_UNEQUAL:
+	case E_LTH:
+	case E_LEQ:
+	case E_GTH:
+	case E_GEQ:
+	case E_RANGE:
+		sym_add_rdep(e->left.sym, sym);
+		sym_add_rdep(e->right.sym, sym);
+		break;
+	default:
+		break;
+	}
+}
+
+/* assign dep_order in reverse post-order, so dependencies come first */
+static void sym_order_rdeps(struct symbol *sym)
+{
+	if (sym->dep_mark)
+		return;
+
+	sym->dep_mark = 1;
+	for (unsigned int i = 0; i < sym->rdeps_nr; i++)
+		sym_order_rdeps(sym->rdeps[i]);
+
+	sym->dep_order = dep_order_next--;
+}
+
+/*
+ * sym_build_rdeps - build the reverse dependency graph
+ *
+ * Record for every symbol which symbols have to be recalculated when its value
+ * changes, so that sym_set_tristate_value() and friends only invalidate those.
+ */
+void sym_build_rdeps(void)
+{
+	struct symbol *sym;
+	struct property *prop;
+	unsigned int nr_syms = 0;
+
+	for_all_symbols(sym) {
+		nr_syms++;
+
+		expr_add_rdeps(sym->dir_dep.expr, sym);
+		expr_add_rdeps(sym->rev_dep.expr, sym);
+		expr_add_rdeps(sym->implied.expr, sym);
+
+		for (prop = sym->prop; prop; prop = prop->next) {
+			switch (prop->type) {
+			case P_PROMPT:
+			case P_DEFAULT:
+			case P_RANGE:
+				expr_add_rdeps(prop->expr, sym);
+				expr_add_rdeps(prop->visible.expr, sym);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	/*
+	 * The members of a choice are calculated together from the defaults of
+	 * the choice and the visibility of each other.
+	 */
+	for_all_symbols(sym) {
+		struct menu *choice;
+		struct symbol *member, *other;
+
+		if (!sym_is_choice(sym) || list_empty(&sym->menus))
+			continue;
+
+		choice = list_first_entry(&sym->menus, struct menu, link);
+		list_for_each_entry(member, &choice->choice_members,
+				    choice_link) {
+			sym_add_rdep(sym, member);
+			list_for_each_entry(other, &choice->choice_members,
+					    choice_link)
+				sym_add_rdep(other, member);
+		}
+	}
+
+	dep_order_next = nr_syms;
+	for_all_symbols(sym)
+		sym_order_rdeps(sym);
+	for_all_symbols(sym)
+		sym->dep_mark = 0;
+
+	rdeps_built = true;
+}
+
+static int sym_dep_order_cmp(const void *a, const void *b)
+{
+	const struct symbol *s1 = *(const struct symbol **)a;
+	const struct symbol *s2 = *(const struct symbol **)b;
+
+	return s1->dep_order < s2->dep_order ? -1 : s1->dep_order > s2->dep_order;
+}
+
+static struct symbol **dep_queue;
+static size_t dep_queue_nr, dep_queue_size;
+
+static void dep_queue_push(struct symbol *sym)
+{
+	if (dep_queue_nr == dep_queue_size) {
+		dep_queue_size = dep_queue_size ? dep_queue_size * 2 : 64;
+		dep_queue = xrealloc(dep_queue,
+				     dep_queue_size * sizeof(*dep_queue));
+	}
+	dep_queue[dep_queue_nr++] = sym;
+}
+
+/*
+ * Invalidate the symbols that depend on the value of sym, directly or
+ * transitively, and recalculate them in topological order.
+ */
+static void sym_invalidate_dependents(struct symbol *sym)
+{
+	static unsigned int mark;
+
+	if (!rdeps_built) {
+		sym_clear_all_valid();
+		return;
+	}
+
+	/* 0 means unmarked */
+	if (++mark == 0)
+		mark = 1;
+
+	dep_queue_nr = 0;
+	sym->dep_mark = mark;
+	dep_queue_push(sym);
+
+	for (size_t head = 0; head < dep_queue_nr; head++) {
+		struct symbol *s = dep_queue[head];
+
+		/* the value of modules affects all tristate expressions */
+		if (s == modules_sym) {
+			sym_clear_all_valid();
+			return;
+		}
+
+		for (unsigned int i = 0; i < s->rdeps_nr; i++) {
+			struct symbol *r = s->rdeps[i];
+
+			if (r->dep_mark == mark)
+				continue;
+			r->dep_mark = mark;
+			dep_queue_push(r);
+		}
+	}
+
+	qsort(dep_queue, dep_queue_nr, sizeof(*dep_queue), sym_dep_order_cmp);
+
+	for (size_t i = 0; i < dep_queue_nr; i++)
+		dep_queue[i]->flags &= ~SYMBOL_VALID;
+	expr_invalidate_all();
+	menu_invalidate_visibility();
+	conf_set_changed(true);
+
+	for (size_t i = 0; i < dep_queue_nr; i++)
+		sym_calc_value(dep_queue[i]);
+}
+
 bool sym_tristate_within_range(const struct symbol *sym, tristate val)
 {
 	int type = sym_get_type(sym);
@@ -568,7 +779,7 @@ bool sym_set_tristate_value(struct symbol *sym, tristate val)
 	}
 
 	if (oldval != val)
-		sym_clear_all_valid();
+		sym_invalidate_dependents(sym);
 
 	return true;
 }
@@ -613,7 +824,7 @@ void choice_set_value(struct menu *choice, struct symbol *sym)
 	}
 
 	if (changed)
-		sym_clear_all_valid();
+		sym_invalidate_dependents(sym);
 }
 
 tristate sym_toggle_tristate_value(struct symbol *sym)
@@ -775,7 +986,7 @@ bool sym_set_string_value(struct symbol *sym, const char *newval)
 
 	strcpy(val, newval);
 	free((void *)oldval);
-	sym_clear_all_valid();
+	sym_invalidate_dependents(sym);
 
 	return true;
 }
@@ -892,13 +1103,92 @@ bool sym_is_choice_value(const struct symbol *sym)
 	return !list_empty(&sym->choice_link);
 }
 
-HASHTABLE_DEFINE(sym_hashtable, SYMBOL_HASHSIZE);
+struct symbol **sym_array;
+unsigned int sym_array_nr;
+static unsigned int sym_array_size;
+
+/*
+ * Open-addressing index of the named symbols. The size is a power of two and
+ * at most half of the slots are used.
+ */
+struct sym_index_slot {
+	unsigned int hash;
+	struct symbol *sym;
+};
+
+static struct sym_index_slot *sym_index;
+static unsigned int sym_index_size, sym_index_nr;
+
+static void sym_index_insert(struct sym_index_slot *index, unsigned int size,
+			     unsigned int hash, struct symbol *sym)
+{
+	unsigned int i;
+
+	for (i = hash & (size - 1); index[i].sym; i = (i + 1) & (size - 1))
+		;
+	index[i].hash = hash;
+	index[i].sym = sym;
+}
+
+static void sym_index_add(struct symbol *sym, unsigned int hash)
+{
+	if ((sym_index_nr + 1) * 2 > sym_index_size) {
+		unsigned int size = sym_index_size ? sym_index_size * 2 : 4096;
+		struct sym_index_slot *index = xcalloc(size, sizeof(*index));
+
+		for (unsigned int i = 0; i < sym_index_size; i++)
+			if (sym_index[i].sym)
+				sym_index_insert(index, size, sym_index[i].hash,
+						 sym_index[i].sym);
+		free(sym_index);
+		sym_index = index;
+		sym_index_size = size;
+	}
+
+	sym_index_insert(sym_index, sym_index_size, hash, sym);
+	sym_index_nr++;
+}
+
+/* hash_str() of the first len characters of name */
+static unsigned int hash_strn(const char *name, size_t len)
+{
+	unsigned int hash = 2166136261U;
+
+	for (size_t i = 0; i < len; i++)
+		hash = (hash ^ name[i]) * 0x01000193;
+	return hash;
+}
+
+/*
+ * Find a named symbol by the first len characters of name. With flags, the
+ * symbol must have one of them set, otherwise it must not be const.
+ */
+static struct symbol *sym_index_find(const char *name, size_t len,
+				     unsigned int hash, int flags)
+{
+	unsigned int mask = sym_index_size - 1;
+
+	if (!sym_index)
+		return NULL;
+
+	for (unsigned int i = hash & mask; sym_index[i].sym; i = (i + 1) & mask) {
+		struct symbol *symbol = sym_index[i].sym;
+
+		if (sym_index[i].hash == hash &&
+		    !strncmp(symbol->name, name, len) && !symbol->name[len] &&
+		    (flags ? symbol->flags & flags
+			   : !(symbol->flags & SYMBOL_CONST)))
+			return symbol;
+	}
+
+	return NULL;
+}
 
 struct symbol *sym_lookup(const char *name, int flags)
 {
 	struct symbol *symbol;
 	char *new_name;
-	int hash;
+	unsigned int hash = 0;
 
 	if (name) {
 		if (name[0] && !name[1]) {
@@ -910,17 +1200,12 @@ struct symbol *sym_lookup(const char *name, int flags)
 		}
 		hash = hash_str(name);
 
-		hash_for_each_possible(sym_hashtable, symbol, node, hash) {
-			if (symbol->name &&
-			    !strcmp(symbol->name, name) &&
-			    (flags ? symbol->flags & flags
-				   : !(symbol->flags & SYMBOL_CONST)))
-				return symbol;
-		}
+		symbol = sym_index_find(name, strlen(name), hash, flags);
+		if (symbol)
+			return symbol;
 		new_name = xstrdup(name);
 	} else {
 		new_name = NULL;
-		hash = 0;
 	}
 
 	symbol = xmalloc(sizeof(*symbol));
@@ -931,16 +1216,22 @@ struct symbol *sym_lookup(const char *name, int flags)
 	INIT_LIST_HEAD(&symbol->menus);
 	INIT_LIST_HEAD(&symbol->choice_link);
 
-	hash_add(sym_hashtable, &symbol->node, hash);
+	if (sym_array_nr == sym_array_size) {
+		sym_array_size = sym_array_size ? sym_array_size * 2 : 4096;
+		sym_array = xrealloc(sym_array,
+				     sym_array_size * sizeof(*sym_array));
+	}
+	symbol->id = sym_array_nr;
+	sym_array[sym_array_nr++] = symbol;
+
+	if (new_name)
+		sym_index_add(symbol, hash);
 
 	return symbol;
 }
 
 struct symbol *sym_find(const char *name)
 {
-	struct symbol *symbol = NULL;
-	int hash = 0;
-
 	if (!name)
 		return NULL;
 
@@ -951,16 +1242,22 @@ struct symbol *sym_find(const char *name)
 		case 'n': return &symbol_no;
 		}
 	}
-	hash = hash_str(name);
 
-	hash_for_each_possible(sym_hashtable, symbol, node, hash) {
-		if (symbol->name &&
-		    !strcmp(symbol->name, name) &&
-		    !(symbol->flags & SYMBOL_CONST))
-				break;
+	return sym_index_find(name, strlen(name), hash_str(name), 0);
+}
+
+/* like sym_find(), for a name that is not terminated after len characters */
+struct symbol *sym_find_n(const char *name, size_t len)
+{
+	if (len == 1) {
+		switch (name[0]) {
+		case 'y': return &symbol_yes;
+		case 'm': return &symbol_mod;
+		case 'n': return &symbol_no;
+		}
 	}
 
-	return symbol;
+	return sym_index_find(name, len, hash_strn(name, len), 0);
 }
 
 struct sym_match {
@@ -998,11 +1295,282 @@ static int sym_rel_comp(const void *sym1, const void *sym2)
 	return strcmp(s1->sym->name, s2->sym->name);
 }
 
+/*
+ * Trigram index over the lower-cased symbol names, to narrow down the
+ * candidates of sym_re_search(). For every trigram, the ids of the symbols
+ * containing it are stored in ascending order in trigram_ids.
+ */
+struct trigram_slot {
+	unsigned int trigram;	/* 0 for an empty slot */
+	unsigned int start, nr;
+};
+
+static struct trigram_slot *trigram_table;
+static unsigned int trigram_table_size;
+static unsigned int *trigram_ids;
+/* symbols with a lower id are in the index */
+static unsigned int trigram_nr_syms;
+
+static unsigned int trigram_of(const char *s)
+{
+	return (unsigned char)tolower(s[0]) << 16 |
+	       (unsigned char)tolower(s[1]) << 8 |
+	       (unsigned char)tolower(s[2]);
+}
+
+static struct trigram_slot *trigram_find(unsigned int trigram)
+{
+	unsigned int mask = trigram_table_size - 1;
+
+	if (!trigram_table)
+		return NULL;
+
+	for (unsigned int i = (trigram * 0x9e3779b1U) >> 8 & mask;
+	     trigram_table[i].trigram; i = (i + 1) & mask)
+		if (trigram_table[i].trigram == trigram)
+			return &trigram_table[i];
+
+	return NULL;
+}
+
+static int trigram_pair_cmp(const void *a, const void *b)
+{
+	unsigned long long p1 = *(const unsigned long long *)a;
+	unsigned long long p2 = *(const unsigned long long *)b;
+
+	return p1 < p2 ? -1 : p1 > p2;
+}
+
+/**
+ * sym_build_search_index - index the symbol names for sym_re_search()
+ *
+ * Symbols created afterwards are searched without the index.
+ */
+void sym_build_search_index(void)
+{
+	unsigned long long *pairs = NULL;
+	size_t nr_pairs = 0, size = 0, nr_ids = 0;
+	unsigned int nr_trigrams = 0, mask;
+	struct symbol *sym;
+
+	for_all_symbols(sym) {
+		size_t len;
+
+		if (sym->flags & SYMBOL_CONST || !sym->name)
+			continue;
+
+		len = strlen(sym->name);
+		for (size_t i = 0; i + 3 <= len; i++) {
+			if (nr_pairs == size) {
+				size = size ? size * 2 : 65536;
+				pairs = xrealloc(pairs, size * sizeof(*pairs));
+			}
+			pairs[nr_pairs++] =
+				(unsigned long long)trigram_of(sym->name + i) << 32 |
+				sym->id;
+		}
+	}
+
+	qsort(pairs, nr_pairs, sizeof(*pairs), trigram_pair_cmp);
+
+	/* drop trigrams occurring more than once in a name */
+	for (size_t i = 0; i < nr_pairs; i++) {
+		if (nr_ids && pairs[nr_ids - 1] == pairs[i])
+			continue;
+		if (!nr_ids || pairs[nr_ids - 1] >> 32 != pairs[i] >> 32)
+			nr_trigrams++;
+		pairs[nr_ids++] = pairs[i];
+	}
+
+	free(trigram_table);
+	free(trigram_ids);
+
+	for (trigram_table_size = 1024; trigram_table_size < nr_trigrams * 2;)
+		trigram_table_size *= 2;
+	trigram_table = xcalloc(trigram_table_size, sizeof(*trigram_table));
+	trigram_ids = xmalloc((nr_ids + 1) * sizeof(*trigram_ids));
+	mask = trigram_table_size - 1;
+
+	for (size_t i = 0; i < nr_ids; i++) {
+		unsigned int trigram = pairs[i] >> 32;
+		struct trigram_slot *slot = NULL;
+
+		if (i && pairs[i - 1] >> 32 == trigram) {
+			slot = trigram_find(trigram);
+		} else {
+			unsigned int j = (trigram * 0x9e3779b1U) >> 8 & mask;
+
+			while (trigram_table[j].trigram)
+				j = (j + 1) & mask;
+			slot = &trigram_table[j];
+			slot->trigram = trigram;
+			slot->start = i;
+		}
+		slot->nr++;
+		trigram_ids[i] = (unsigned int)pairs[i];
+	}
+
+	trigram_nr_syms = sym_array_nr;
+	free(pairs);
+}
+
+/*
+ * Collect the runs of literal characters that every match of an extended
+ * regular expression has to contain, lower-cased and separated by '\0' in buf,
+ * which has to be as large as the pattern. Return the length of the runs, or 0
+ * if the pattern is too complex to tell.
+ */
+static size_t re_literal_runs(const char *pattern, char *buf)
+{
+	size_t len = 0, run = 0;
+	int depth = 0;
+
+#define END_RUN()	do { if (run) { buf[len++] = '\0'; run = 0; } } while (0)
+	for (const char *p = pattern; *p; p++) {
+		switch (*p) {
+		case '|':
+			return 0;
+		case '[':
+			END_RUN();
+			p++;
+			/* a ']' right after the opening bracket is literal */
+			if (*p == '^')
+				p++;
+			if (*p == ']')
+				p++;
+			while (*p && *p != ']') {
+				/* [:class:], [.coll.] and [=equiv=] */
+				if (*p == '[' &&
+				    (p[1] == ':' || p[1] == '.' || p[1] == '=')) {
+					char close = p[1];
+
+					for (p += 2; *p && !(*p == close && p[1] == ']');)
+						p++;
+					if (*p)
+						p += 2;
+					continue;
+				}
+				p++;
+			}
+			if (!*p)
+				return 0;
+			break;
+		case '(':
+			END_RUN();
+			depth++;
+			break;
+		case ')':
+			END_RUN();
+			depth--;
+			break;
+		case '?':
+		case '*':
+		case '{':
+			/* the preceding character is optional */
+			if (run) {
+				len--;
+				run--;
+			}
+			END_RUN();
+			if (*p == '{')
+				while (p[1] && *p != '}')
+					p++;
+			break;
+		case '\\':
+			END_RUN();
+			if (p[1])
+				p++;
+			break;
+		case '+':
+		case '.':
+		case '^':
+		case '$':
+			END_RUN();
+			break;
+		default:
+			if (depth) {
+				END_RUN();
+				break;
+			}
+			buf[len++] = tolower((unsigned char)*p);
+			run++;
+			break;
+		}
+	}
+	END_RUN();
+#undef END_RUN
+
+	return len;
+}
+
+/*
+ * Narrow down the symbols the pattern can match with the trigram index.
+ * Return the number of candidate ids stored in *ids, or -1 if every indexed
+ * symbol is a candidate.
+ */
+static int sym_search_candidates(const char *pattern, unsigned int **ids)
+{
+	char *runs = xmalloc(strlen(pattern) + 1);
+	size_t len = re_literal_runs(pattern, runs);
+	unsigned int *cand = NULL;
+	int nr = -1;
+
+	for (const char *run = runs; run < runs + len;
+	     run += strlen(run) + 1) {
+		for (size_t i = 0; i + 3 <= strlen(run); i++) {
+			struct trigram_slot *slot = trigram_find(trigram_of(run + i));
+			const unsigned int *post;
+			int n = 0;
+
+			if (!slot) {
+				nr = 0;
+				goto out;
+			}
+			post = &trigram_ids[slot->start];
+
+			if (nr < 0) {
+				cand = xmalloc(slot->nr * sizeof(*cand));
+				memcpy(cand, post, slot->nr * sizeof(*cand));
+				nr = slot->nr;
+				continue;
+			}
+
+			/* intersect the sorted id lists */
+			for (int a = 0, b = 0; a < nr && b < (int)slot->nr;) {
+				if (cand[a] < post[b]) {
+					a++;
+				} else if (cand[a] > post[b]) {
+					b++;
+				} else {
+					cand[n++] = cand[a];
+					a++;
+					b++;
+				}
+			}
+			nr = n;
+			if (!nr)
+				goto out;
+		}
+	}
+out:
+	free(runs);
+	*ids = cand;
+	return nr;
+}
+
+static bool sym_re_match(regex_t *re, struct symbol *sym, regmatch_t *match)
+{
+	if (sym->flags & SYMBOL_CONST || !sym->name)
+		return false;
+	return !regexec(re, sym->name, 1, match, 0);
+}
+
 struct symbol **sym_re_search(const char *pattern)
 {
 	struct symbol *sym, **sym_arr = NULL;
 	struct sym_match *sym_match_arr = NULL;
-	int i, cnt, size;
+	unsigned int *cand = NULL, id;
+	int i, cnt, size, nr_cand;
 	regex_t re;
 	regmatch_t match[1];
 
@@ -1013,10 +1581,21 @@ struct symbol **sym_re_search(const char *pattern)
 	if (regcomp(&re, pattern, REG_EXTENDED|REG_ICASE))
 		return NULL;
 
-	for_all_symbols(sym) {
-		if (sym->flags & SYMBOL_CONST || !sym->name)
-			continue;
-		if (regexec(&re, sym->name, 1, match, 0))
+	nr_cand = trigram_table ? sym_search_candidates(pattern, &cand) : -1;
+
+	for (i = 0; ; i++) {
+		/* the candidates from the index, then the symbols not indexed */
+		if (nr_cand < 0)
+			id = i;
+		else if (i < nr_cand)
+			id = cand[i];
+		else
+			id = trigram_nr_syms + (i - nr_cand);
+		if (id >= sym_array_nr)
+			break;
+
+		sym = sym_array[id];
+		if (!sym_re_match(&re, sym, match))
 			continue;
 		if (cnt >= size) {
 			void *tmp;
@@ -1046,6 +1625,7 @@ struct symbol **sym_re_search(const char *pattern)
 sym_re_search_free:
 	/* sym_match_arr can be NULL if no match, but free(NULL) is OK */
 	free(sym_match_arr);
+	free(cand);
 	regfree(&re);
 
 	return sym_arr;
@@ -41,6 +41,7 @@ const char *file_lookup(const char *name)
 	hash_add(file_hashtable, &file->node, hash);
 
 	str_printf(&autoconf_cmd, "\t%s \\\n", name);
+	snapshot_add_file(file->name);
 
 	return file->name;
 }